@@ -0,0 +1,78 @@
+#ifndef _DEVKIT_ALLOCATOR_H
+#define _DEVKIT_ALLOCATOR_H
+
+#if defined(__STDC__) && __STDC__ < 202311L
+#define nullptr NULL
+#include <stdbool.h>
+#endif
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+ * ####################
+ * # DEVKIT ALLOCATOR #
+ * ####################
+ */
+
+/* Interface shared by the devkit structures to get their memory from somewhere
+ * else than the standard library (an arena, a pool...).
+ * Every function receives 'context', the state of the allocator.
+ * A null allocator means the standard library */
+
+typedef struct devkit_allocator {
+	void* (*allocate)( void *context, size_t size);
+	void* (*reallocate)( void *context, void *ptr, size_t old_size, size_t new_size);
+	void (*deallocate)( void *context, void *ptr, size_t size);
+	void *context;
+} DevkitAllocator;
+
+#ifdef DEVKIT_STRIP_PREFIXES
+typedef DevkitAllocator Allocator;
+#endif
+
+
+/* Allocates 'size' bytes with 'allocator' */
+extern void* devkit_allocator_alloc( const DevkitAllocator *allocator, size_t size);
+/* Allocates 'nmemb'*'size' zeroed bytes with 'allocator' */
+extern void* devkit_allocator_calloc( const DevkitAllocator *allocator, size_t nmemb, size_t size);
+/* Resizes 'ptr' from 'old_size' to 'new_size' bytes with 'allocator' */
+extern void* devkit_allocator_realloc( const DevkitAllocator *allocator, void *ptr, size_t old_size, size_t new_size);
+/* Gives 'ptr' of 'size' bytes back to 'allocator' */
+extern void devkit_allocator_free( const DevkitAllocator *allocator, void *ptr, size_t size);
+
+
+
+
+/* IMPLEMENTATION */
+
+#define DEVKIT_ALLOCATOR_IMPLEMENTATION
+#ifdef DEVKIT_ALLOCATOR_IMPLEMENTATION
+
+void* devkit_allocator_alloc( const DevkitAllocator *allocator, size_t size) {
+	if (!allocator) return malloc( size);
+	return allocator->allocate( allocator->context, size);
+}
+
+void* devkit_allocator_calloc( const DevkitAllocator *allocator, size_t nmemb, size_t size) {
+	if (!allocator) return calloc( nmemb, size);
+	void *ptr = allocator->allocate( allocator->context, nmemb*size);
+	if (ptr) memset( ptr, 0, nmemb*size);
+	return ptr;
+}
+
+void* devkit_allocator_realloc( const DevkitAllocator *allocator, void *ptr, size_t old_size, size_t new_size) {
+	if (!allocator) return realloc( ptr, new_size);
+	return allocator->reallocate( allocator->context, ptr, old_size, new_size);
+}
+
+void devkit_allocator_free( const DevkitAllocator *allocator, void *ptr, size_t size) {
+	if (!allocator) free( ptr);
+	else allocator->deallocate( allocator->context, ptr, size);
+}
+
+#endif
+
+#endif
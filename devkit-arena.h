@@ -1,16 +1,32 @@
 #ifndef _DEVKIT_ARENA_H
 #define _DEVKIT_ARENA_H
 
+// Needed by mmap flags and madvise when compiling in strict ISO mode
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #if defined(__STDC__) && __STDC__ < 202311L
 #define nullptr NULL
 #include <stdbool.h>
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <stdio.h>
 
+#include "devkit-allocator.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DEVKIT_ARENA_VIRTUAL_MEMORY
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 
 /* 
  * ################
@@ -18,27 +34,159 @@
  * ################
  */
 
+/* Define DEVKIT_ARENA_STATS before including this header to
+ * keep usage counters in every arena (see 'devkit_arena_stats') */
+
 /* Struct definition */
 
+typedef enum {
+	DEVKIT_ARENA_FIXED,	// Single buffer, resets (or exits) when full
+	DEVKIT_ARENA_GROWABLE,	// Chains new blocks when full
+	DEVKIT_ARENA_VIRTUAL	// Reserved address range, pages committed on demand
+} DevkitArenaKind;
+
+/* Header of every block of a growable arena. The block memory follows it */
+typedef struct devkit_arena_block {
+	struct devkit_arena_block *prev; // Also the link of the free list of a pool
+	size_t size;
+	bool pooled; // Block belongs to a DevkitArenaPool
+#ifdef DEVKIT_ARENA_STATS
+	size_t base; // Bytes in use in the previous blocks of the chain
+#endif
+} DevkitArenaBlock;
+
+#define DEVKIT_ARENA_BLOCK_HEADER \
+	((sizeof(DevkitArenaBlock) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1))
+
+/* Shared lock-free stack of equally sized blocks, refilling the arenas of many threads.
+ * Blocks are aligned to DEVKIT_ARENA_POOL_ALIGN so that the low bits of the head
+ * can hold a tag against ABA */
+typedef struct {
+	_Atomic uintptr_t head; // Tagged pointer to the first free block
+	size_t block_size;
+	atomic_size_t blocks; // Blocks allocated by the pool and not yet destroyed
+} DevkitArenaPool;
+
+#define DEVKIT_ARENA_POOL_ALIGN 4096
+#define _DEVKIT_ARENA_POOL_TAG ((uintptr_t)DEVKIT_ARENA_POOL_ALIGN - 1)
+
+/* Usage of an arena. Counters other than 'in_use' and 'capacity'
+ * are only kept if DEVKIT_ARENA_STATS is defined */
+typedef struct {
+	size_t allocated; // Bytes requested since creation
+	size_t in_use; // Bytes in use, padding included
+	size_t peak; // Highest value of 'in_use' (high-water mark)
+	size_t capacity; // Bytes available without allocating (blocks, or committed pages)
+	size_t resets;
+	size_t blocks; // Blocks chained since creation
+	size_t wasted; // Bytes lost to alignment padding and to the unused tail of full blocks
+} DevkitArenaStats;
+
 typedef struct {
 	bool noreset;
 	size_t size;
 	size_t cursor;
 	void *data;
+	DevkitArenaKind kind;
+	DevkitArenaBlock *block; // Current block (growable arenas only)
+	size_t max_block; // Maximum size of a chained block
+	DevkitArenaPool *pool; // Source of new blocks, if not null
+	size_t committed; // Bytes of the reserved range that are readable/writable (virtual arenas only)
+	size_t granule; // Commit granularity (virtual arenas only)
+	DevkitAllocator allocator; // Set by 'devkit_arena_allocator'
+#ifdef DEVKIT_ARENA_STATS
+	DevkitArenaStats stats;
+#endif
 } DevkitArena;
 
+/* Commit granularity of virtual arenas, and of virtual arenas using huge pages */
+#define DEVKIT_ARENA_COMMIT_SIZE (64 * 1024)
+#define DEVKIT_ARENA_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/* Savepoint of an arena, to free everything allocated after it at once */
+typedef struct {
+	DevkitArenaBlock *block;
+	size_t cursor;
+} DevkitArenaMark;
+
+/* Size of a cache line, to align buffers for vectorized code */
+#define DEVKIT_CACHE_LINE 64
+
+/* Typed allocation of 'n' zeroed items of type 'T', aligned for 'T' */
+#define DEVKIT_ARENA_NEW( arena, T, n) \
+	((T*) devkit_arena_calloc_aligned( (arena), (n), sizeof(T), _Alignof(T)))
+/* Same as above with a custom alignment (power of two) */
+#define DEVKIT_ARENA_NEW_ALIGNED( arena, T, n, align) \
+	((T*) devkit_arena_calloc_aligned( (arena), (n), sizeof(T), (align)))
+/* Same as above, aligned to a cache line */
+#define DEVKIT_ARENA_NEW_CACHELINE( arena, T, n) \
+	DEVKIT_ARENA_NEW_ALIGNED( (arena), T, (n), DEVKIT_CACHE_LINE)
+
 #ifdef DEVKIT_STRIP_PREFIXES
 typedef DevkitArena Arena;
+typedef DevkitArenaPool ArenaPool;
+typedef DevkitArenaMark ArenaMark;
+typedef DevkitArenaStats ArenaStats;
+
+#define CACHE_LINE DEVKIT_CACHE_LINE
+#define ARENA_NEW DEVKIT_ARENA_NEW
+#define ARENA_NEW_ALIGNED DEVKIT_ARENA_NEW_ALIGNED
+#define ARENA_NEW_CACHELINE DEVKIT_ARENA_NEW_CACHELINE
+
+#define arena_mark devkit_arena_mark
+#define arena_rewind devkit_arena_rewind
+#define arena_scope devkit_arena_scope
+#define arena_stats devkit_arena_stats
 #endif
 
 
 extern DevkitArena devkit_arena_new( size_t size, bool noreset); // Constructor
 
+/* Creates an arena that never runs out of memory: when the current block is full,
+ * a new one is chained, doubling the size of the previous block up to 'max_block' bytes.
+ * Requests larger than 'max_block' get a block of their own size */
+extern DevkitArena devkit_arena_growable( size_t size, size_t max_block);
+
+#ifdef DEVKIT_ARENA_VIRTUAL_MEMORY
+/* Creates an arena that reserves 'reserve' bytes of address space without using
+ * memory: pages are committed as the cursor advances and released on reset.
+ * If 'hugepages' is set, the kernel is asked to back the arena with huge pages.
+ * When the reservation is full, the arena behaves like a fixed one */
+extern DevkitArena devkit_arena_virtual( size_t reserve, bool noreset, bool hugepages);
+#endif
+
+/* Creates a pool of blocks of 'block_size' bytes that can be shared between threads */
+extern DevkitArenaPool* devkit_arena_pool( size_t block_size);
+/* Frees every block of 'pool' and the pool itself.
+ * All the arenas using the pool must be destroyed before */
+extern void devkit_arena_pool_destroy( DevkitArenaPool *pool);
+
+/* Creates a growable arena whose blocks come from 'pool' and go back to it on reset.
+ * An arena is NOT thread-safe: give one to each thread */
+extern DevkitArena devkit_arena_pooled( DevkitArenaPool *pool);
+/* Gives the arena of the calling thread, refilled by 'pool' */
+extern DevkitArena* devkit_arena_local( DevkitArenaPool *pool);
+/* Gives the blocks of the calling thread arena back to its pool. Call it before
+ * a thread exits, or its blocks are lost */
+extern void devkit_arena_local_release();
+
+/* Gives an allocator that takes memory from 'arena', to build devkit structures in it.
+ * It stays valid as long as 'arena' is not moved. Freeing gives memory back only
+ * for the last allocation, everything else is freed when the arena is reset.
+ * It never resets the arena: if a fixed or virtual arena is full, the program exits */
+extern const DevkitAllocator* devkit_arena_allocator( DevkitArena *arena);
+
 /* Reserve 'size' bytes of memory to a new pointer */
 extern void* devkit_arena_alloc( DevkitArena *arena, size_t size);
 /* Reserve a cluster of 'nmemb'*'size' bytes of memory to a new pointer */
 extern void* devkit_arena_calloc( DevkitArena *arena, size_t nmemb, size_t size);
-/* Reset arena cursor to zero */
+/* Same as 'devkit_arena_alloc', the pointer is aligned to 'align' bytes (power of two) */
+extern void* devkit_arena_alloc_aligned( DevkitArena *arena, size_t size, size_t align);
+/* Same as 'devkit_arena_calloc', the pointer is aligned to 'align' bytes (power of two) */
+extern void* devkit_arena_calloc_aligned( DevkitArena *arena, size_t nmemb, size_t size, size_t align);
+/* Reset arena cursor to zero.
+ * Growable arenas keep only their largest block for reuse,
+ * virtual arenas give their pages back to the system */
 extern void devkit_arena_reset( DevkitArena *arena);
 extern void devkit_arena_destroy( DevkitArena *arena);
 
@@ -47,6 +195,24 @@ extern void devkit_arena_destroy( DevkitArena *arena);
  * Use cautiously to deallocate only what you want to. */
 extern void devkit_arena_free( DevkitArena *arena, void* ptr, size_t size);
 
+/* Gives a snapshot of the usage of 'arena' */
+extern DevkitArenaStats devkit_arena_stats( const DevkitArena *arena);
+
+/* Gives a savepoint at the current position of 'arena' */
+extern DevkitArenaMark devkit_arena_mark( DevkitArena *arena);
+/* Frees everything allocated in 'arena' after 'mark'. Marks taken after 'mark'
+ * become invalid, as well as 'mark' itself if the arena was reset in the meantime */
+extern void devkit_arena_rewind( DevkitArena *arena, DevkitArenaMark mark);
+
+/* Runs the code in the variadic arguments, then frees every allocation it made
+ * in 'arena'. Scopes can be nested.
+ * Do not 'return' or 'goto' out of the scope, as the arena would not be rewound */
+#define devkit_arena_scope( arena, ...) { \
+	DevkitArenaMark _devkit_arena_scope_mark = devkit_arena_mark( (arena)); \
+	__VA_ARGS__; \
+	devkit_arena_rewind( (arena), _devkit_arena_scope_mark); \
+}
+
 
 
 
@@ -61,60 +227,426 @@ DevkitArena devkit_arena_new( size_t size, bool noreset) {
 		.size = size,
 		.cursor = 0,
 		.data = data,
-		.noreset = noreset
+		.noreset = noreset,
+		.kind = DEVKIT_ARENA_FIXED,
+		.block = nullptr,
+		.pool = nullptr
 	};
 }
 
 
-void* devkit_arena_calloc( DevkitArena *arena, size_t nmemb, size_t size) {
-	size_t totalsize = nmemb*size;
-	if ( totalsize > arena->size - arena->cursor) {
-		if ( arena->noreset) {
-			puts("DevkitArena has run out of memory and cannot reset!");
-			exit(EXIT_FAILURE);
-		}
-		else devkit_arena_reset( arena);
+DevkitArena devkit_arena_growable( size_t size, size_t max_block) {
+#ifdef DEVKIT_DEBUG
+	assert( size > 0 && size <= max_block);
+#endif
+	DevkitArenaBlock *block = malloc( DEVKIT_ARENA_BLOCK_HEADER + size);
+	assert( block && "DevkitArena: could not allocate first block!!!");
+	*block = (DevkitArenaBlock) { .prev = nullptr, .size = size, .pooled = false };
+	return (DevkitArena) {
+		.size = size,
+		.cursor = 0,
+		.data = (char*)block + DEVKIT_ARENA_BLOCK_HEADER,
+		.noreset = false,
+		.kind = DEVKIT_ARENA_GROWABLE,
+		.block = block,
+		.max_block = max_block,
+		.pool = nullptr
+	};
+}
+
+
+#ifdef DEVKIT_ARENA_VIRTUAL_MEMORY
+DevkitArena devkit_arena_virtual( size_t reserve, bool noreset, bool hugepages) {
+	size_t granule = hugepages ? DEVKIT_ARENA_HUGEPAGE_SIZE : DEVKIT_ARENA_COMMIT_SIZE;
+	reserve = (reserve + granule - 1) & ~(granule - 1);
+
+	// Reserve one more granule to align the range, so that huge pages can be used
+	size_t span = reserve + granule;
+	char *range = mmap( nullptr, span, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	assert( range != MAP_FAILED && "DevkitArena: could not reserve virtual memory!!!");
+
+	char *data = (char*)(((uintptr_t)range + granule - 1) & ~(uintptr_t)(granule - 1));
+	if ( data != range) munmap( range, data - range);
+	munmap( data + reserve, range + span - (data + reserve));
+#ifdef MADV_HUGEPAGE
+	if (hugepages) madvise( data, reserve, MADV_HUGEPAGE);
+#endif
+
+	return (DevkitArena) {
+		.size = reserve,
+		.cursor = 0,
+		.data = data,
+		.noreset = noreset,
+		.kind = DEVKIT_ARENA_VIRTUAL,
+		.block = nullptr,
+		.pool = nullptr,
+		.committed = 0,
+		.granule = granule
+	};
+}
+
+
+/* Makes the first 'end' bytes of a virtual arena usable */
+void _devkit_arena_commit( DevkitArena *arena, size_t end) {
+	size_t committed = (end + arena->granule - 1) & ~(arena->granule - 1);
+	if ( committed > arena->size) committed = arena->size;
+	if ( mprotect( arena->data + arena->committed, committed - arena->committed,
+				PROT_READ | PROT_WRITE) != 0) {
+		puts("DevkitArena could not commit memory!");
+		exit(EXIT_FAILURE);
+	}
+	arena->committed = committed;
+}
+#endif
+
+
+DevkitArenaPool* devkit_arena_pool( size_t block_size) {
+	DevkitArenaPool *pool = malloc( sizeof(*pool));
+	assert( pool && "DevkitArena: could not allocate pool!!!");
+	atomic_init( &pool->head, 0);
+	atomic_init( &pool->blocks, 0);
+	pool->block_size = block_size;
+	return pool;
+}
+
+
+void devkit_arena_pool_destroy( DevkitArenaPool *pool) {
+	if (!pool) return;
+
+	DevkitArenaBlock *block = (DevkitArenaBlock*)(atomic_load( &pool->head) & ~_DEVKIT_ARENA_POOL_TAG);
+	for (DevkitArenaBlock *prev; block; block = prev) {
+		prev = block->prev;
+		free( block);
+		atomic_fetch_sub( &pool->blocks, 1);
+	}
+#ifdef DEVKIT_DEBUG
+	assert( atomic_load( &pool->blocks) == 0 && "DevkitArena: pool destroyed while blocks are in use!!!");
+#endif
+	free( pool);
+}
+
+
+/* Takes a block from 'pool', allocating a new one if the pool is empty */
+DevkitArenaBlock* _devkit_arena_pool_pop( DevkitArenaPool *pool) {
+	uintptr_t head = atomic_load( &pool->head);
+	DevkitArenaBlock *block;
+	do {
+		block = (DevkitArenaBlock*)(head & ~_DEVKIT_ARENA_POOL_TAG);
+		if (!block) break;
+		// 'block' may be popped concurrently, but its memory stays valid until the
+		// pool is destroyed and the tag makes the exchange fail in that case
+	} while ( !atomic_compare_exchange_weak( &pool->head, &head,
+				(uintptr_t)block->prev | ((head + 1) & _DEVKIT_ARENA_POOL_TAG)));
+
+	if (!block) {
+		size_t total = DEVKIT_ARENA_BLOCK_HEADER + pool->block_size;
+		total = (total + DEVKIT_ARENA_POOL_ALIGN - 1) & ~_DEVKIT_ARENA_POOL_TAG;
+		block = aligned_alloc( DEVKIT_ARENA_POOL_ALIGN, total);
+		if (!block) return nullptr;
+		atomic_fetch_add( &pool->blocks, 1);
+	}
+	*block = (DevkitArenaBlock) { .prev = nullptr, .size = pool->block_size, .pooled = true };
+	return block;
+}
+
+
+/* Gives 'block' back to 'pool' */
+void _devkit_arena_pool_push( DevkitArenaPool *pool, DevkitArenaBlock *block) {
+	uintptr_t head = atomic_load( &pool->head);
+	do {
+		block->prev = (DevkitArenaBlock*)(head & ~_DEVKIT_ARENA_POOL_TAG);
+	} while ( !atomic_compare_exchange_weak( &pool->head, &head,
+				(uintptr_t)block | ((head + 1) & _DEVKIT_ARENA_POOL_TAG)));
+}
+
+
+/* Frees a block of a growable arena, or gives it back to its pool */
+void _devkit_arena_release_block( DevkitArena *arena, DevkitArenaBlock *block) {
+	if ( block->pooled) _devkit_arena_pool_push( arena->pool, block);
+	else free( block);
+}
+
+
+/* Makes 'block' the current block of 'arena' */
+void _devkit_arena_use_block( DevkitArena *arena, DevkitArenaBlock *block) {
+	arena->block = block;
+	arena->data = (char*)block + DEVKIT_ARENA_BLOCK_HEADER;
+	arena->size = block->size;
+}
+
+
+DevkitArena devkit_arena_pooled( DevkitArenaPool *pool) {
+	DevkitArenaBlock *block = _devkit_arena_pool_pop( pool);
+	assert( block && "DevkitArena: could not allocate first block!!!");
+	DevkitArena arena = {
+		.cursor = 0,
+		.noreset = false,
+		.kind = DEVKIT_ARENA_GROWABLE,
+		.max_block = pool->block_size,
+		.pool = pool
+	};
+	_devkit_arena_use_block( &arena, block);
+	return arena;
+}
+
+
+_Thread_local DevkitArena _DEVKIT_ARENA_LOCAL = {0};
+
+DevkitArena* devkit_arena_local( DevkitArenaPool *pool) {
+	if ( _DEVKIT_ARENA_LOCAL.pool != pool) {
+		devkit_arena_local_release();
+		_DEVKIT_ARENA_LOCAL = devkit_arena_pooled( pool);
 	}
-	// Allocation
-	void *newptr = arena->data + arena->cursor;
+	return &_DEVKIT_ARENA_LOCAL;
+}
+
+
+void devkit_arena_local_release() {
+	if (!_DEVKIT_ARENA_LOCAL.pool) return;
+	devkit_arena_destroy( &_DEVKIT_ARENA_LOCAL);
+	_DEVKIT_ARENA_LOCAL = (DevkitArena) {0};
+}
+
+
+/* Chains a new block able to hold at least 'size' bytes */
+void _devkit_arena_grow( DevkitArena *arena, size_t size) {
+	size_t newsize = arena->size * 2;
+	if ( newsize > arena->max_block) newsize = arena->max_block;
+	if ( newsize < size) newsize = size;
+
+	DevkitArenaBlock *block = nullptr;
+	if ( arena->pool && size <= arena->pool->block_size)
+		block = _devkit_arena_pool_pop( arena->pool);
+	else if ( (block = malloc( DEVKIT_ARENA_BLOCK_HEADER + newsize)))
+		*block = (DevkitArenaBlock) { .size = newsize, .pooled = false };
+
+	if (!block) {
+		puts("DevkitArena could not allocate a new block!");
+		exit(EXIT_FAILURE);
+	}
+#ifdef DEVKIT_ARENA_STATS
+	arena->stats.wasted += arena->size - arena->cursor;
+	++arena->stats.blocks;
+	block->base = arena->block->base + arena->cursor;
+#endif
+	block->prev = arena->block;
+	_devkit_arena_use_block( arena, block);
+	arena->cursor = 0;
+}
+
+
+/* Makes room for 'size' bytes in 'arena', according to its kind */
+void _devkit_arena_reserve( DevkitArena *arena, size_t size) {
+	if ( size <= arena->size - arena->cursor) return;
+
+	if ( arena->kind == DEVKIT_ARENA_GROWABLE)
+		_devkit_arena_grow( arena, size);
+	else if ( arena->noreset) {
+		puts("DevkitArena has run out of memory and cannot reset!");
+		exit(EXIT_FAILURE);
+	}
+	else devkit_arena_reset( arena);
+}
+
+
+/* Bytes to skip from the cursor to reach an address aligned to 'align' */
+size_t _devkit_arena_padding( DevkitArena *arena, size_t align) {
+	uintptr_t address = (uintptr_t)arena->data + arena->cursor;
+	return -address & (align - 1);
+}
+
+
+void* devkit_arena_calloc_aligned( DevkitArena *arena, size_t nmemb, size_t size, size_t align) {
+	size_t totalsize = nmemb*size;
+	void *newptr = devkit_arena_alloc_aligned( arena, totalsize, align);
 	memset( newptr, 0, totalsize);
-	arena->cursor += totalsize;
 	return newptr;
 }
 
 
-void* devkit_arena_alloc( DevkitArena *arena, size_t size) {
-	if ( size > arena->size - arena->cursor) {
-		if ( arena->noreset) {
-			puts("DevkitArena has run out of memory and cannot reset!");
-			exit(EXIT_FAILURE);
-		}
-		else devkit_arena_reset( arena);
+void* devkit_arena_alloc_aligned( DevkitArena *arena, size_t size, size_t align) {
+	assert( align && !(align & (align - 1)) && "DevkitArena: alignment must be a power of two!!!");
+
+	size_t padding = _devkit_arena_padding( arena, align);
+	if ( padding + size > arena->size - arena->cursor) {
+		// Worst case padding, so that the new space is always enough
+		_devkit_arena_reserve( arena, size + align - 1);
+		padding = _devkit_arena_padding( arena, align);
 	}
 
-	void *newptr = arena->data + arena->cursor;
-	arena->cursor += size;
+	void *newptr = arena->data + arena->cursor + padding;
+	arena->cursor += padding + size;
+#ifdef DEVKIT_ARENA_STATS
+	arena->stats.allocated += size;
+	arena->stats.wasted += padding;
+	size_t in_use = (arena->block ? arena->block->base : 0) + arena->cursor;
+	if ( in_use > arena->stats.peak) arena->stats.peak = in_use;
+#endif
+#ifdef DEVKIT_ARENA_VIRTUAL_MEMORY
+	if ( arena->kind == DEVKIT_ARENA_VIRTUAL && arena->cursor > arena->committed)
+		_devkit_arena_commit( arena, arena->cursor);
+#endif
 	return newptr;
 }
 
 
+void* devkit_arena_calloc( DevkitArena *arena, size_t nmemb, size_t size) {
+	return devkit_arena_calloc_aligned( arena, nmemb, size, 1);
+}
+
+
+void* devkit_arena_alloc( DevkitArena *arena, size_t size) {
+	return devkit_arena_alloc_aligned( arena, size, 1);
+}
+
+
 void devkit_arena_destroy( DevkitArena *arena) {
 	if (!arena) return;
 
-	free( arena->data);
+	if ( arena->kind == DEVKIT_ARENA_GROWABLE) {
+		for (DevkitArenaBlock *block = arena->block, *prev; block; block = prev) {
+			prev = block->prev;
+			_devkit_arena_release_block( arena, block);
+		}
+		arena->block = nullptr;
+	}
+#ifdef DEVKIT_ARENA_VIRTUAL_MEMORY
+	else if ( arena->kind == DEVKIT_ARENA_VIRTUAL) {
+		munmap( arena->data, arena->size);
+		arena->committed = 0;
+	}
+#endif
+	else free( arena->data);
 	arena->cursor = 0, arena->size = 0;
 }
 
 
 void devkit_arena_free( DevkitArena *arena, void* ptr, size_t size) {
+	// Drop the blocks chained after the one that contains 'ptr'
+	while ( arena->block && arena->block->prev &&
+			( (char*)ptr < (char*)arena->data || (char*)ptr > (char*)arena->data + arena->size)) {
+		DevkitArenaBlock *prev = arena->block->prev;
+		_devkit_arena_release_block( arena, arena->block);
+		_devkit_arena_use_block( arena, prev);
+	}
 	size_t delta = ptr - arena->data;
-	assert( delta >= 0 && "DevkitArena: Cannot deallocate at address outside of buffer!!!");
+	assert( delta <= arena->size && "DevkitArena: Cannot deallocate at address outside of buffer!!!");
 	arena->cursor = delta;
 }
 
+void* _devkit_arena_allocate( void *context, size_t size) {
+	DevkitArena *arena = context;
+	// Resetting a full arena would free the other structures built in it
+	if ( arena->kind != DEVKIT_ARENA_GROWABLE
+			&& _devkit_arena_padding( arena, _Alignof(max_align_t)) + size > arena->size - arena->cursor) {
+		puts("DevkitArena has run out of memory for the structures built in it!");
+		exit(EXIT_FAILURE);
+	}
+	return devkit_arena_alloc_aligned( arena, size, _Alignof(max_align_t));
+}
+
+void* _devkit_arena_reallocate( void *context, void *ptr, size_t old_size, size_t new_size) {
+	DevkitArena *arena = context;
+	// The last allocation can be resized in place
+	if ( ptr && (char*)ptr + old_size == (char*)arena->data + arena->cursor
+			&& ( new_size <= old_size || new_size - old_size <= arena->size - arena->cursor)) {
+		arena->cursor = arena->cursor - old_size + new_size;
+#ifdef DEVKIT_ARENA_STATS
+		// Count the growth like a new allocation of the extra bytes
+		if ( new_size > old_size) arena->stats.allocated += new_size - old_size;
+		size_t in_use = (arena->block ? arena->block->base : 0) + arena->cursor;
+		if ( in_use > arena->stats.peak) arena->stats.peak = in_use;
+#endif
+#ifdef DEVKIT_ARENA_VIRTUAL_MEMORY
+		if ( arena->kind == DEVKIT_ARENA_VIRTUAL && arena->cursor > arena->committed)
+			_devkit_arena_commit( arena, arena->cursor);
+#endif
+		return ptr;
+	}
+	void *newptr = _devkit_arena_allocate( arena, new_size);
+	if (ptr) memcpy( newptr, ptr, old_size < new_size ? old_size : new_size);
+	return newptr;
+}
+
+void _devkit_arena_deallocate( void *context, void *ptr, size_t size) {
+	DevkitArena *arena = context;
+	if ( ptr && (char*)ptr + size == (char*)arena->data + arena->cursor)
+		arena->cursor -= size;
+}
+
+const DevkitAllocator* devkit_arena_allocator( DevkitArena *arena) {
+	arena->allocator = (DevkitAllocator) {
+		.allocate = _devkit_arena_allocate,
+		.reallocate = _devkit_arena_reallocate,
+		.deallocate = _devkit_arena_deallocate,
+		.context = arena
+	};
+	return &arena->allocator;
+}
+
+
+DevkitArenaMark devkit_arena_mark( DevkitArena *arena) {
+	return (DevkitArenaMark) { .block = arena->block, .cursor = arena->cursor };
+}
+
+void devkit_arena_rewind( DevkitArena *arena, DevkitArenaMark mark) {
+	// Drop the blocks chained after the marked one
+	while ( arena->block != mark.block && arena->block->prev) {
+		DevkitArenaBlock *prev = arena->block->prev;
+		_devkit_arena_release_block( arena, arena->block);
+		_devkit_arena_use_block( arena, prev);
+	}
+	assert( arena->block == mark.block && mark.cursor <= arena->size
+			&& "DevkitArena: rewind to a mark that is not valid anymore!!!");
+	arena->cursor = mark.cursor;
+}
+
 void devkit_arena_reset( DevkitArena *arena) {
 	assert( !arena->noreset && "DevkitArena: called 'reset' action on a buffer flagged as 'noreset'!!!");
 	arena->cursor = 0;
+#ifdef DEVKIT_ARENA_STATS
+	++arena->stats.resets;
+#endif
+#ifdef DEVKIT_ARENA_VIRTUAL_MEMORY
+	// Pages stay committed, but their memory goes back to the system
+	if ( arena->kind == DEVKIT_ARENA_VIRTUAL && arena->committed)
+		madvise( arena->data, arena->committed, MADV_DONTNEED);
+#endif
+	if ( arena->kind != DEVKIT_ARENA_GROWABLE) return;
+
+	// Keep the largest block, free the others (or give them back to the pool)
+	DevkitArenaBlock *largest = arena->block;
+	for (DevkitArenaBlock *block = arena->block; block; block = block->prev) {
+		if ( block->size > largest->size) largest = block;
+	}
+	for (DevkitArenaBlock *block = arena->block, *prev; block; block = prev) {
+		prev = block->prev;
+		if ( block != largest) _devkit_arena_release_block( arena, block);
+	}
+	largest->prev = nullptr;
+#ifdef DEVKIT_ARENA_STATS
+	largest->base = 0;
+#endif
+	_devkit_arena_use_block( arena, largest);
+}
+
+
+DevkitArenaStats devkit_arena_stats( const DevkitArena *arena) {
+#ifdef DEVKIT_ARENA_STATS
+	DevkitArenaStats stats = arena->stats;
+	stats.in_use = (arena->block ? arena->block->base : 0) + arena->cursor;
+#else
+	// Without the counters, previous blocks are counted as full
+	DevkitArenaStats stats = { .in_use = arena->cursor };
+	for (DevkitArenaBlock *block = arena->block ? arena->block->prev : nullptr; block; block = block->prev)
+		stats.in_use += block->size;
+#endif
+	stats.capacity = 0;
+	if ( arena->kind == DEVKIT_ARENA_VIRTUAL) stats.capacity = arena->committed;
+	else if ( arena->kind == DEVKIT_ARENA_FIXED) stats.capacity = arena->size;
+	else for (DevkitArenaBlock *block = arena->block; block; block = block->prev)
+		stats.capacity += block->size;
+	return stats;
 }
 
 #endif
@@ -1,6 +1,11 @@
 #ifndef _DEVKIT_DEBUGGER_H
 #define _DEVKIT_DEBUGGER_H
 
+// Needed by clock_gettime and the file functions when compiling in strict ISO mode
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #if defined(__STDC__) && __STDC__ < 202311L
 #define nullptr NULL
 #include <stdbool.h>
@@ -15,7 +20,62 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <locale.h>
+#ifdef DEVKIT_DEBUGGER_SAMPLE
+#include <math.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <sys/resource.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#endif
+
+/*
+ * Settings
+ *
+ * DEVKIT_DEBUGGER_TRACE: instead of printing every allocation and keeping the
+ *	register, append binary records to a per-thread buffer that is written to
+ *	DEVKIT_DEBUGGER_TRACE_FILE in large chunks. Read it with devkit-trace.c
+ * DEVKIT_DEBUGGER_NO_MACROS: do not replace malloc, calloc and free
+ * DEVKIT_DEBUGGER_PROFILE_TOP: number of call sites shown by the profile
+ *	report of devkit_debug_close_register (0 to hide it)
+ * DEVKIT_DEBUGGER_SAMPLE: instead of tracking every allocation, track about one
+ *	every DEVKIT_DEBUGGER_SAMPLE_RATE bytes allocated, without printing them.
+ *	The sizes of sampled allocations are scaled up in the profile, so that its
+ *	totals and live bytes are estimates of the real ones. Cheap enough to stay on.
+ *	Needs libm: link with -lm
+ * DEVKIT_DEBUGGER_ZONE_FILE: where the zones are exported at exit, in the
+ *	Chrome trace format (open it in Perfetto or chrome://tracing)
+ * DEVKIT_DEBUGGER_NO_ZONES: compile DEVKIT_ZONE, DEVKIT_ZONE_COUNTER and
+ *	DEVKIT_COUNTERS out
+ */
+
+#ifndef DEVKIT_DEBUGGER_TRACE_FILE
+#define DEVKIT_DEBUGGER_TRACE_FILE "devkit.trace"
+#endif
+
+#ifndef DEVKIT_DEBUGGER_PROFILE_TOP
+#define DEVKIT_DEBUGGER_PROFILE_TOP 10
+#endif
+
+#ifndef DEVKIT_DEBUGGER_SAMPLE_RATE
+#define DEVKIT_DEBUGGER_SAMPLE_RATE (512*1024)
+#endif
+
+#ifndef DEVKIT_DEBUGGER_ZONE_FILE
+#define DEVKIT_DEBUGGER_ZONE_FILE "devkit-zones.json"
+#endif
 
 /*
  * Struct definitions
@@ -30,25 +90,181 @@ typedef struct {
 	void *pointer;
 	size_t size;
 	DevkitLocation location;
+	uint64_t timestamp; // Of the allocation, in nanoseconds
+	size_t weight; // Bytes it stands for in the profile: its size, or more if sampled
 } DevkitPointer;
 
 
+/* Open addressing hash table of the live allocations, keyed by pointer.
+ * Removed entries leave a tombstone so that probing goes on past them.
+ * The register is split in shards, each with its own lock, so that
+ * threads allocating at the same time rarely wait for each other */
 typedef struct {
 	DevkitPointer *items;
-	size_t size, capacity, available;
+	size_t size, capacity, tombstones;
+	pthread_mutex_t lock;
 } DevkitRegister;
 
-DevkitRegister DEVKIT_REGISTER;
+#define DEVKIT_REGISTER_TOMBSTONE ((void*)UINTPTR_MAX)
+/* Capacity of the register if it is used before being set up */
+#define DEVKIT_REGISTER_DEFAULT_CAPACITY 1024
+/* Number of shards of the register (power of two) */
+#define DEVKIT_REGISTER_SHARDS 64
+
+DevkitRegister DEVKIT_REGISTER[DEVKIT_REGISTER_SHARDS];
 bool DEVKIT_REGISTER_SET = false;
+size_t _DEVKIT_REGISTER_CAPACITY = DEVKIT_REGISTER_DEFAULT_CAPACITY;
+pthread_once_t _DEVKIT_REGISTER_ONCE = PTHREAD_ONCE_INIT;
 
 constexpr DevkitPointer DEVKIT_POINTER_NULL = {0};
 
+
+/* Number of buckets of the size histogram of a call site.
+ * Bucket 0 counts allocations up to 16 bytes, bucket N those up to 16 << N,
+ * the last one everything bigger */
+#define DEVKIT_PROFILE_BUCKETS 16
+
+/* Allocations of a call site, summed up */
+typedef struct {
+	DevkitLocation location;
+	size_t allocations, frees;
+	size_t bytes; // Allocated in total
+	size_t live_bytes, peak_bytes;
+	uint64_t lifetime; // Of freed allocations, in nanoseconds
+	size_t histogram[DEVKIT_PROFILE_BUCKETS];
+} DevkitSiteProfile;
+
+/* Open addressing hash table of the call sites, split in shards like the register */
+typedef struct {
+	DevkitSiteProfile *items;
+	size_t size, capacity;
+	pthread_mutex_t lock;
+} DevkitProfile;
+
+/* Number of shards of the profile (power of two) */
+#define DEVKIT_PROFILE_SHARDS 16
+
+DevkitProfile DEVKIT_PROFILE[DEVKIT_PROFILE_SHARDS];
+
+/* Mean number of bytes allocated between two samples.
+ * Change it before the program starts allocating */
+size_t DEVKIT_SAMPLE_RATE = DEVKIT_DEBUGGER_SAMPLE_RATE;
+
+/* Sampled pointers counted by hash, so that most frees skip the register */
+#define DEVKIT_SAMPLE_FILTER_SLOTS (1 << 14)
+atomic_uint _DEVKIT_SAMPLE_FILTER[DEVKIT_SAMPLE_FILTER_SLOTS];
+
+// Bytes left before the next sample, and the random state of the thread
+_Thread_local int64_t _DEVKIT_SAMPLE_COUNTDOWN = 0;
+_Thread_local uint64_t _DEVKIT_SAMPLE_STATE = 0;
+
 #define DEVKIT_LOCATION_PTR( _file, _function, _line) ((DevkitLocation) {\
 	.file = (_file), \
 	.function = (_function), \
 	.line = (_line) \
 })
 
+/*
+ * Trace format: a DEVKIT_TRACE_MAGIC header, then fixed size records.
+ * The first time a thread uses a call site, a DEVKIT_TRACE_SITE record gives
+ * its id, its line in 'pointer' and in 'size' the length of the payload that
+ * follows: file and function names, null terminated, padded to a whole record.
+ * Records of different threads are interleaved by chunks, sort them by timestamp
+ */
+
+#define DEVKIT_TRACE_MAGIC "DKTRACE1"
+
+typedef enum {
+	DEVKIT_TRACE_MALLOC = 1,
+	DEVKIT_TRACE_CALLOC,
+	DEVKIT_TRACE_FREE,
+	DEVKIT_TRACE_SITE
+} DevkitTraceOp;
+
+typedef struct {
+	uint64_t timestamp; // Nanoseconds, monotonic clock
+	uint64_t pointer;
+	uint64_t size;
+	uint32_t site; // Call site id
+	uint32_t op; // DevkitTraceOp
+} DevkitTraceRecord;
+
+/* Records kept by a thread before writing them */
+#define DEVKIT_TRACE_BUFFER_RECORDS 4096
+/* Call sites cached by each thread (power of two) */
+#define DEVKIT_TRACE_SITE_CACHE 256
+/* Longest file or function name written in a trace */
+#define DEVKIT_TRACE_NAME_MAX 255
+
+/*
+ * Zones: DEVKIT_ZONE("name") times the rest of the enclosing block.
+ * Every thread appends the begin and end of its zones to its own buffer,
+ * so zones nest like the blocks that contain them
+ */
+
+typedef enum {
+	DEVKIT_ZONE_BEGIN,
+	DEVKIT_ZONE_END,
+	DEVKIT_ZONE_COUNTER
+} DevkitZonePhase;
+
+typedef struct {
+	uint64_t ticks; // Timestamp counter, or nanoseconds where there is none
+	const char *name;
+	const DevkitLocation *location;
+	double value; // Of counters
+	DevkitZonePhase phase;
+} DevkitZoneEvent;
+
+/* Events of a thread. Buffers are kept after their thread exits, to be exported */
+typedef struct devkit_zone_buffer {
+	DevkitZoneEvent *events;
+	size_t length, capacity;
+	uint32_t thread; // Numbered in order of first zone
+	struct devkit_zone_buffer *next;
+} DevkitZoneBuffer;
+
+/* Value of a zone variable: it ends the zone when it goes out of scope */
+typedef struct {
+	const char *name;
+} DevkitZone;
+
+/*
+ * Counters: DEVKIT_COUNTERS("name", elements) reads the hardware counters of
+ * the thread (through perf_event_open) over the rest of the enclosing block,
+ * and adds them to the totals of its call site. Counters that the CPU or the
+ * kernel do not give are left out; without perf_event_open at all, only the
+ * CPU time and the page faults of the thread are counted
+ */
+
+typedef enum {
+	DEVKIT_COUNTER_CYCLES,
+	DEVKIT_COUNTER_INSTRUCTIONS,
+	DEVKIT_COUNTER_L1_MISSES, // L1 data cache read misses
+	DEVKIT_COUNTER_LLC_MISSES, // Last level cache misses
+	DEVKIT_COUNTER_BRANCH_MISSES,
+	DEVKIT_COUNTER_CPU_TIME, // Nanoseconds
+	DEVKIT_COUNTER_PAGE_FAULTS,
+	DEVKIT_COUNTER_KINDS
+} DevkitCounterKind;
+
+/* Totals of a call site of DEVKIT_COUNTERS */
+typedef struct devkit_counter_site {
+	const char *name;
+	DevkitLocation location;
+	atomic_ulong calls, elements;
+	atomic_ulong values[DEVKIT_COUNTER_KINDS];
+	atomic_bool registered;
+	struct devkit_counter_site *next;
+} DevkitCounterSite;
+
+/* Value of a DEVKIT_COUNTERS variable: it adds the counts to 'site' when it goes out of scope */
+typedef struct {
+	DevkitCounterSite *site;
+	size_t elements;
+	uint64_t start[DEVKIT_COUNTER_KINDS];
+} DevkitCounterScope;
+
 #define DEVKIT_DEBUGGER_NULLPTR_WARNING "Devkit debugger: pointer is null!"
 #define DEVKIT_DEBUGGER_ALLOC_FAIL(size) "Devkit Debugger: allocation failed (%lu bytes)!", (size)
 
@@ -71,13 +287,52 @@ constexpr DevkitPointer DEVKIT_POINTER_NULL = {0};
 
 /* Function declarations */
 
+/* Creates the register with room for 'capacity' pointers. It grows as needed.
+ * All the functions of the register are thread-safe */
 extern void devkit_debug_setup_register( size_t capacity);
 extern void devkit_debug_register_ptr( DevkitLocation *, void *pointer, size_t size);
-extern void devkit_debug_update_available();
+/* Registers 'pointer' as standing for 'weight' bytes in the profile */
+extern void devkit_debug_register_weighted( DevkitLocation *, void *pointer, size_t size, size_t weight);
+/* Copies the register entry of 'pointer' into 'dest'.
+ * Returns false if 'pointer' is not registered */
+extern bool devkit_debug_find_ptr( void *pointer, DevkitPointer *dest);
+/* Removes 'pointer' from the register, copying its entry into 'dest' if not null.
+ * Returns false if 'pointer' is not registered */
+extern bool devkit_debug_unregister_ptr( void *pointer, DevkitPointer *dest);
 extern void devkit_debug_close_register();
 
 extern bool devkit_debug_pointer_isnull( DevkitPointer *this);
 
+/* Prints the 'top' call sites that allocated the most bytes, with their
+ * allocation count, peak of live bytes, average lifetime and size histogram */
+extern void devkit_debug_profile_report( size_t top);
+/* Copies the profile of every call site into a new array and gives its length.
+ * Give the array back with 'devkit_debug_profile_free' */
+extern size_t devkit_debug_profile( DevkitSiteProfile **dest);
+/* Frees an array given by 'devkit_debug_profile'. It does not come from the
+ * tracked 'malloc', so the replaced 'free' would report it */
+extern void devkit_debug_profile_free( DevkitSiteProfile *sites);
+/* Gives the bytes that are allocated and not freed yet, estimated if sampling */
+extern size_t devkit_debug_live_bytes();
+
+/* Starts writing the allocation trace to 'path' (DEVKIT_DEBUGGER_TRACE_FILE by default) */
+extern void devkit_debug_trace_open( const char *path);
+/* Writes the records buffered by the calling thread */
+extern void devkit_debug_trace_flush();
+
+/* Records the value of the counter 'name' (drawn as a graph by the trace viewers) */
+extern void devkit_zone_counter( const char *name, double value);
+/* Writes the zones of every thread to 'path' (DEVKIT_DEBUGGER_ZONE_FILE by default)
+ * in the Chrome trace format. Other threads must not be recording zones meanwhile */
+extern void devkit_zone_export( const char *path);
+
+/* Reads the counters of the calling thread into 'values'.
+ * Gives a mask of the counters that are available (bit N for DevkitCounterKind N) */
+extern unsigned devkit_counters_read( uint64_t values[DEVKIT_COUNTER_KINDS]);
+/* Prints the counters of every DEVKIT_COUNTERS call site, with the IPC and the
+ * misses per element. It also runs at exit */
+extern void devkit_counters_report();
+
 extern void* devkit_debug_allocate( DevkitLocation, size_t size);
 extern void* devkit_debug_callocate( DevkitLocation, size_t nmemb, size_t size);
 extern void devkit_debug_free( DevkitLocation, void *pointer);
@@ -85,65 +340,504 @@ extern void devkit_debug_free( DevkitLocation, void *pointer);
 
 /* IMPLEMENTATION */
 
+extern uint64_t _devkit_debug_now() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+/* PROFILE IMPLEMENTATION */
+
+extern void _devkit_debug_init_register();
+
+extern size_t _devkit_debug_site_hash( DevkitLocation *loc) {
+	uint64_t h = (uintptr_t)loc->file ^ (uintptr_t)loc->function * 31 ^ (uint64_t)loc->line * 0x9e3779b9;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/* Gives the profile of the call site 'loc', adding it if new. The shard must be locked */
+extern DevkitSiteProfile* _devkit_debug_site( DevkitProfile *shard, size_t hash, DevkitLocation *loc) {
+	if ( (shard->size + 1) * 4 > shard->capacity * 3) {
+		DevkitSiteProfile *old = shard->items;
+		size_t old_capacity = shard->capacity;
+		shard->capacity = old_capacity ? 2*old_capacity : 64;
+		shard->items = calloc( shard->capacity, sizeof(DevkitSiteProfile));
+		if (!shard->items) {
+			puts("Devkit Debugger: could not grow the profile!");
+			exit(EXIT_FAILURE);
+		}
+		for (size_t idx = 0; idx < old_capacity; idx++) {
+			if ( !old[idx].location.file) continue;
+			size_t slot = _devkit_debug_site_hash( &old[idx].location) & (shard->capacity - 1);
+			while ( shard->items[slot].location.file)
+				slot = (slot + 1) & (shard->capacity - 1);
+			shard->items[slot] = old[idx];
+		}
+		free( old);
+	}
+
+	size_t mask = shard->capacity - 1;
+	size_t slot = hash & mask;
+	while ( shard->items[slot].location.file) {
+		DevkitLocation *known = &shard->items[slot].location;
+		if ( known->file == loc->file && known->function == loc->function && known->line == loc->line)
+			return &shard->items[slot];
+		slot = (slot + 1) & mask;
+	}
+	shard->items[slot] = (DevkitSiteProfile) { .location = *loc };
+	++shard->size;
+	return &shard->items[slot];
+}
+
+extern void _devkit_debug_init_profile() {
+	for (size_t shard = 0; shard < DEVKIT_PROFILE_SHARDS; shard++)
+		pthread_mutex_init( &DEVKIT_PROFILE[shard].lock, nullptr);
+}
+
+/* Gives the number of allocations of 'size' bytes that 'weight' bytes stand for */
+extern size_t _devkit_debug_profile_count( size_t size, size_t weight) {
+	return size ? (weight + size/2) / size : 1;
+}
+
+extern void _devkit_debug_profile_alloc( DevkitLocation *loc, size_t size, size_t weight) {
+	size_t hash = _devkit_debug_site_hash( loc);
+	DevkitProfile *shard = &DEVKIT_PROFILE[hash >> 60 & (DEVKIT_PROFILE_SHARDS - 1)];
+	size_t bucket = size > 16 ? 64 - __builtin_clzll( size - 1) - 4 : 0;
+	if ( bucket >= DEVKIT_PROFILE_BUCKETS) bucket = DEVKIT_PROFILE_BUCKETS - 1;
+	size_t count = _devkit_debug_profile_count( size, weight);
+
+	pthread_mutex_lock( &shard->lock);
+	DevkitSiteProfile *site = _devkit_debug_site( shard, hash, loc);
+	site->allocations += count;
+	site->bytes += weight;
+	site->live_bytes += weight;
+	if ( site->live_bytes > site->peak_bytes) site->peak_bytes = site->live_bytes;
+	site->histogram[bucket] += count;
+	pthread_mutex_unlock( &shard->lock);
+}
+
+/* Accounts the free of 'entry' to the call site that allocated it */
+extern void _devkit_debug_profile_free( DevkitPointer *entry) {
+	size_t hash = _devkit_debug_site_hash( &entry->location);
+	DevkitProfile *shard = &DEVKIT_PROFILE[hash >> 60 & (DEVKIT_PROFILE_SHARDS - 1)];
+	uint64_t lifetime = _devkit_debug_now() - entry->timestamp;
+	size_t count = _devkit_debug_profile_count( entry->size, entry->weight);
+
+	pthread_mutex_lock( &shard->lock);
+	DevkitSiteProfile *site = _devkit_debug_site( shard, hash, &entry->location);
+	site->frees += count;
+	site->live_bytes -= entry->weight;
+	site->lifetime += lifetime * count;
+	pthread_mutex_unlock( &shard->lock);
+}
+
+extern size_t devkit_debug_profile( DevkitSiteProfile **dest) {
+	pthread_once( &_DEVKIT_REGISTER_ONCE, _devkit_debug_init_register);
+
+	for (size_t shard = 0; shard < DEVKIT_PROFILE_SHARDS; shard++)
+		pthread_mutex_lock( &DEVKIT_PROFILE[shard].lock);
+	size_t length = 0;
+	for (size_t shard = 0; shard < DEVKIT_PROFILE_SHARDS; shard++)
+		length += DEVKIT_PROFILE[shard].size;
+
+	DevkitSiteProfile *sites = malloc( (length ? length : 1) * sizeof(DevkitSiteProfile));
+	size_t idx = 0;
+	for (size_t shard = 0; shard < DEVKIT_PROFILE_SHARDS; shard++) {
+		DevkitProfile *profile = &DEVKIT_PROFILE[shard];
+		for (size_t slot = 0; slot < profile->capacity; slot++) {
+			if ( profile->items[slot].location.file) sites[idx++] = profile->items[slot];
+		}
+		pthread_mutex_unlock( &profile->lock);
+	}
+	*dest = sites;
+	return length;
+}
+
+extern void devkit_debug_profile_free( DevkitSiteProfile *sites) {
+	free( sites);
+}
+
+extern size_t devkit_debug_live_bytes() {
+	size_t live = 0;
+	for (size_t shard = 0; shard < DEVKIT_PROFILE_SHARDS; shard++) {
+		DevkitProfile *profile = &DEVKIT_PROFILE[shard];
+		pthread_mutex_lock( &profile->lock);
+		for (size_t slot = 0; slot < profile->capacity; slot++)
+			live += profile->items[slot].live_bytes;
+		pthread_mutex_unlock( &profile->lock);
+	}
+	return live;
+}
+
+extern int _devkit_debug_compare_sites( const void *a, const void *b) {
+	const DevkitSiteProfile *x = a, *y = b;
+	return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+extern void devkit_debug_profile_report( size_t top) {
+	DevkitSiteProfile *sites;
+	size_t length = devkit_debug_profile( &sites);
+	qsort( sites, length, sizeof(DevkitSiteProfile), _devkit_debug_compare_sites);
+
+#ifdef DEVKIT_DEBUGGER_SAMPLE
+	printf(" Estimated from one sample every %zu bytes\n", DEVKIT_SAMPLE_RATE);
+#endif
+	size_t live = 0;
+	for (size_t idx = 0; idx < length; idx++) live += sites[idx].live_bytes;
+	printf(" %zu bytes still allocated\n", live);
+	printf(" Top %zu of %zu call sites by bytes allocated:\n", top < length ? top : length, length);
+	for (size_t idx = 0; idx < length && idx < top; idx++) {
+		DevkitSiteProfile *site = &sites[idx];
+		printf(" %s:%d (%s)\n", site->location.file, site->location.line, site->location.function);
+		printf("   %zu allocations, %zu bytes, peak %zu live bytes, ",
+				site->allocations, site->bytes, site->peak_bytes);
+		if ( site->frees)
+			printf("average lifetime %.1f us\n", site->lifetime / 1e3 / site->frees);
+		else
+			puts("never freed");
+
+		printf("   sizes:");
+		for (size_t bucket = 0; bucket < DEVKIT_PROFILE_BUCKETS; bucket++) {
+			if ( !site->histogram[bucket]) continue;
+			if ( bucket == DEVKIT_PROFILE_BUCKETS - 1)
+				printf(" >%zu: %zu", (size_t)16 << (bucket - 1), site->histogram[bucket]);
+			else
+				printf(" <=%zu: %zu", (size_t)16 << bucket, site->histogram[bucket]);
+		}
+		putchar('\n');
+	}
+	devkit_debug_profile_free( sites);
+}
+
+
 extern void devkit_debug_close_register() {
 	puts("-----------------");
 	puts(" On exit:");
 	puts("-----------------");
 
-	bool problems;
-	for (size_t idx = 0; idx < DEVKIT_REGISTER.capacity; idx++) {
-		DevkitPointer *ptr_data = &DEVKIT_REGISTER.items[idx];
-		if ( devkit_debug_pointer_isnull(ptr_data))
-			continue;
+	bool problems = false;
+	for (size_t shard = 0; shard < DEVKIT_REGISTER_SHARDS; shard++) {
+		DevkitRegister *reg = &DEVKIT_REGISTER[shard];
+		pthread_mutex_lock( &reg->lock);
+		for (size_t idx = 0; idx < reg->capacity; idx++) {
+			DevkitPointer *ptr_data = &reg->items[idx];
+			if ( devkit_debug_pointer_isnull(ptr_data) || ptr_data->pointer == DEVKIT_REGISTER_TOMBSTONE)
+				continue;
 
-		if (ptr_data->pointer) {
 			DEVKIT_DEBUGGER_WARN(&ptr_data->location,
 					"pointer %p of size %lu was not freed before exit",
 					ptr_data->pointer, ptr_data->size);
-			if (!problems) problems = true;
+			problems = true;
 		}
+		// The tables stay allocated: atexit handlers registered later and
+		// threads still running keep allocating and freeing through them
+		pthread_mutex_unlock( &reg->lock);
 	}
 	if (!problems)
 		puts(" Everything should be fine");
-	free(DEVKIT_REGISTER.items);
+
+	if ( DEVKIT_DEBUGGER_PROFILE_TOP > 0) {
+		puts("-----------------");
+		devkit_debug_profile_report( DEVKIT_DEBUGGER_PROFILE_TOP);
+	}
+}
+
+extern void _devkit_debug_init_register() {
+	// Capacity of each shard is a power of two, so that hashes can be masked
+	size_t pow2 = 16;
+	while (pow2 * DEVKIT_REGISTER_SHARDS < _DEVKIT_REGISTER_CAPACITY) pow2 <<= 1;
+
+	for (size_t shard = 0; shard < DEVKIT_REGISTER_SHARDS; shard++) {
+		DevkitRegister *reg = &DEVKIT_REGISTER[shard];
+		*reg = (DevkitRegister) {
+			.items = calloc( pow2, sizeof(DevkitPointer)),
+			.capacity = pow2,
+			.size = 0,
+			.tombstones = 0
+		};
+		pthread_mutex_init( &reg->lock, nullptr);
+	}
+	_devkit_debug_init_profile();
+	DEVKIT_REGISTER_SET = true;
+	atexit( devkit_debug_close_register);
 }
 
 extern void devkit_debug_setup_register( size_t capacity) {
-	if (DEVKIT_REGISTER_SET)
-		return;
+	_DEVKIT_REGISTER_CAPACITY = capacity;
+	pthread_once( &_DEVKIT_REGISTER_ONCE, _devkit_debug_init_register);
+}
+
+/* Mixes the bits of 'pointer', as its lowest bits are always zero */
+extern size_t _devkit_debug_hash( void *pointer) {
+	uint64_t h = (uintptr_t)pointer;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return (size_t)h;
+}
+
+/* Shard of 'hash': its highest bits, the lowest pick the slot */
+#define _devkit_debug_shard( hash) \
+	(&DEVKIT_REGISTER[((hash) >> (sizeof(size_t)*8 - 6)) & (DEVKIT_REGISTER_SHARDS - 1)])
+
+/* Moves every entry of 'reg' to a table of 'capacity' slots, dropping the tombstones */
+extern void _devkit_debug_rehash( DevkitRegister *reg, size_t capacity) {
 	DevkitPointer *items = calloc( capacity, sizeof(DevkitPointer));
-	DEVKIT_REGISTER = (DevkitRegister) {
-		.items = items,
-		.capacity = capacity,
-		.size = 0,
-		.available = 0
-	};
-	atexit( devkit_debug_close_register);
+	if (!items) {
+		puts("Devkit Debugger: could not grow the register!");
+		exit(EXIT_FAILURE);
+	}
+	for (size_t idx = 0; idx < reg->capacity; idx++) {
+		DevkitPointer *entry = &reg->items[idx];
+		if ( devkit_debug_pointer_isnull(entry) || entry->pointer == DEVKIT_REGISTER_TOMBSTONE)
+			continue;
+		size_t slot = _devkit_debug_hash( entry->pointer) & (capacity - 1);
+		while ( !devkit_debug_pointer_isnull( &items[slot]))
+			slot = (slot + 1) & (capacity - 1);
+		items[slot] = *entry;
+	}
+	free( reg->items);
+	reg->items = items;
+	reg->capacity = capacity;
+	reg->tombstones = 0;
 }
 
 extern void devkit_debug_register_ptr( DevkitLocation *loc, void *pointer, size_t size) {
-	if (DEVKIT_REGISTER.size >= DEVKIT_REGISTER.capacity - 1) {
-		DEVKIT_DEBUGGER_PRINTINFO(loc, "register is full!");
-		return;
+	devkit_debug_register_weighted( loc, pointer, size, size);
+}
+
+extern void devkit_debug_register_weighted( DevkitLocation *loc, void *pointer, size_t size, size_t weight) {
+	pthread_once( &_DEVKIT_REGISTER_ONCE, _devkit_debug_init_register);
+
+	size_t hash = _devkit_debug_hash( pointer);
+	DevkitRegister *reg = _devkit_debug_shard( hash);
+	pthread_mutex_lock( &reg->lock);
+
+	// Keep the load (tombstones included) under 3/4
+	if ( (reg->size + reg->tombstones + 1) * 4 > reg->capacity * 3) {
+		size_t capacity = reg->capacity;
+		if ( (reg->size + 1) * 2 > capacity) capacity *= 2;
+		_devkit_debug_rehash( reg, capacity);
 	}
-	DEVKIT_REGISTER.items[DEVKIT_REGISTER.available] = (DevkitPointer) {
+
+	size_t mask = reg->capacity - 1;
+	size_t slot = hash & mask;
+	while ( !devkit_debug_pointer_isnull( &reg->items[slot])
+			&& reg->items[slot].pointer != DEVKIT_REGISTER_TOMBSTONE)
+		slot = (slot + 1) & mask;
+
+	if ( reg->items[slot].pointer == DEVKIT_REGISTER_TOMBSTONE)
+		--reg->tombstones;
+	reg->items[slot] = (DevkitPointer) {
 		.pointer = pointer,
 		.size = size,
-		.location = *loc
+		.location = *loc,
+		.timestamp = _devkit_debug_now(),
+		.weight = weight
+	};
+	++reg->size;
+	pthread_mutex_unlock( &reg->lock);
+	_devkit_debug_profile_alloc( loc, size, weight);
+}
+
+
+/* Gives the slot of 'pointer' in 'reg', or null. The shard must be locked */
+extern DevkitPointer* _devkit_debug_lookup( DevkitRegister *reg, size_t hash, void *pointer) {
+	size_t mask = reg->capacity - 1;
+	size_t slot = hash & mask;
+	while ( !devkit_debug_pointer_isnull( &reg->items[slot])) {
+		if ( reg->items[slot].pointer == pointer)
+			return &reg->items[slot];
+		slot = (slot + 1) & mask;
+	}
+	return nullptr;
+}
+
+extern bool devkit_debug_find_ptr( void *pointer, DevkitPointer *dest) {
+	if (!pointer) return false;
+	pthread_once( &_DEVKIT_REGISTER_ONCE, _devkit_debug_init_register);
+
+	size_t hash = _devkit_debug_hash( pointer);
+	DevkitRegister *reg = _devkit_debug_shard( hash);
+	pthread_mutex_lock( &reg->lock);
+	DevkitPointer *entry = _devkit_debug_lookup( reg, hash, pointer);
+	if ( entry && dest) *dest = *entry;
+	pthread_mutex_unlock( &reg->lock);
+	return entry != nullptr;
+}
+
+extern bool devkit_debug_unregister_ptr( void *pointer, DevkitPointer *dest) {
+	if (!pointer) return false;
+	pthread_once( &_DEVKIT_REGISTER_ONCE, _devkit_debug_init_register);
+
+	size_t hash = _devkit_debug_hash( pointer);
+	DevkitRegister *reg = _devkit_debug_shard( hash);
+	pthread_mutex_lock( &reg->lock);
+	DevkitPointer *entry = _devkit_debug_lookup( reg, hash, pointer);
+	DevkitPointer removed;
+	if ( entry) {
+		removed = *entry;
+		if (dest) *dest = removed;
+		// Leave a tombstone
+		*entry = (DevkitPointer) { .pointer = DEVKIT_REGISTER_TOMBSTONE };
+		--reg->size;
+		++reg->tombstones;
+	}
+	pthread_mutex_unlock( &reg->lock);
+	if ( entry) _devkit_debug_profile_free( &removed);
+	return entry != nullptr;
+}
+
+
+/* TRACE IMPLEMENTATION */
+
+typedef struct {
+	const char *file, *function;
+	int line;
+	uint32_t id;
+} _DevkitTraceSite;
+
+int _DEVKIT_TRACE_FD = -1;
+pthread_mutex_t _DEVKIT_TRACE_LOCK = PTHREAD_MUTEX_INITIALIZER;
+pthread_key_t _DEVKIT_TRACE_KEY;
+
+// Call sites known by every thread, with their id
+_DevkitTraceSite *_DEVKIT_TRACE_SITES = nullptr;
+size_t _DEVKIT_TRACE_SITES_CAPACITY = 0, _DEVKIT_TRACE_SITES_LENGTH = 0;
+
+_Thread_local DevkitTraceRecord *_DEVKIT_TRACE_BUFFER = nullptr;
+_Thread_local size_t _DEVKIT_TRACE_LENGTH = 0;
+_Thread_local _DevkitTraceSite _DEVKIT_TRACE_SITE_CACHE[DEVKIT_TRACE_SITE_CACHE];
+
+extern void _devkit_debug_trace_write( const void *data, size_t size) {
+	while (size) {
+		ssize_t written = write( _DEVKIT_TRACE_FD, data, size);
+		if (written <= 0) return;
+		data = (const char*)data + written, size -= written;
+	}
+}
+
+extern void devkit_debug_trace_flush() {
+	if ( !_DEVKIT_TRACE_LENGTH) return;
+	// A single write per chunk, so that chunks of different threads never mix
+	_devkit_debug_trace_write( _DEVKIT_TRACE_BUFFER, _DEVKIT_TRACE_LENGTH * sizeof(DevkitTraceRecord));
+	_DEVKIT_TRACE_LENGTH = 0;
+}
+
+/* Flushes and frees the buffer of a thread that is exiting */
+extern void _devkit_debug_trace_thread_exit( void *buffer) {
+	devkit_debug_trace_flush();
+	free( buffer);
+	_DEVKIT_TRACE_BUFFER = nullptr;
+}
+
+extern void _devkit_debug_trace_close() {
+	devkit_debug_trace_flush();
+	close( _DEVKIT_TRACE_FD);
+}
+
+extern void devkit_debug_trace_open( const char *path) {
+	pthread_mutex_lock( &_DEVKIT_TRACE_LOCK);
+	if ( _DEVKIT_TRACE_FD < 0) {
+		if (!path) path = DEVKIT_DEBUGGER_TRACE_FILE;
+		_DEVKIT_TRACE_FD = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+		if ( _DEVKIT_TRACE_FD < 0) {
+			printf("Devkit Debugger: could not open trace file %s!\n", path);
+			exit(EXIT_FAILURE);
+		}
+		_devkit_debug_trace_write( DEVKIT_TRACE_MAGIC, sizeof(DEVKIT_TRACE_MAGIC) - 1);
+		pthread_key_create( &_DEVKIT_TRACE_KEY, _devkit_debug_trace_thread_exit);
+		atexit( _devkit_debug_trace_close);
+	}
+	pthread_mutex_unlock( &_DEVKIT_TRACE_LOCK);
+}
+
+/* Gives the next free record of the calling thread, flushing if needed */
+extern DevkitTraceRecord* _devkit_debug_trace_next() {
+	if ( !_DEVKIT_TRACE_BUFFER) {
+		if ( _DEVKIT_TRACE_FD < 0) devkit_debug_trace_open( nullptr);
+		_DEVKIT_TRACE_BUFFER = malloc( DEVKIT_TRACE_BUFFER_RECORDS * sizeof(DevkitTraceRecord));
+		pthread_setspecific( _DEVKIT_TRACE_KEY, _DEVKIT_TRACE_BUFFER);
+	}
+	if ( _DEVKIT_TRACE_LENGTH == DEVKIT_TRACE_BUFFER_RECORDS)
+		devkit_debug_trace_flush();
+	return &_DEVKIT_TRACE_BUFFER[_DEVKIT_TRACE_LENGTH++];
+}
+
+/* Writes the definition of 'site' in the trace of the calling thread */
+extern void _devkit_debug_trace_site( _DevkitTraceSite *site) {
+	size_t file = strnlen( site->file, DEVKIT_TRACE_NAME_MAX),
+		   function = strnlen( site->function, DEVKIT_TRACE_NAME_MAX);
+	size_t payload = file + function + 2;
+	size_t nrecords = (payload + sizeof(DevkitTraceRecord) - 1) / sizeof(DevkitTraceRecord);
+
+	// Header and payload must be in the same chunk
+	if ( _DEVKIT_TRACE_BUFFER && _DEVKIT_TRACE_LENGTH + 1 + nrecords > DEVKIT_TRACE_BUFFER_RECORDS)
+		devkit_debug_trace_flush();
+	*_devkit_debug_trace_next() = (DevkitTraceRecord) {
+		.timestamp = _devkit_debug_now(),
+		.pointer = (uint64_t)site->line,
+		.size = payload,
+		.site = site->id,
+		.op = DEVKIT_TRACE_SITE
 	};
-	++DEVKIT_REGISTER.size;
-	devkit_debug_update_available();
+	char *names = (char*)&_DEVKIT_TRACE_BUFFER[_DEVKIT_TRACE_LENGTH];
+	memset( names, 0, nrecords * sizeof(DevkitTraceRecord));
+	memcpy( names, site->file, file);
+	memcpy( names + file + 1, site->function, function);
+	_DEVKIT_TRACE_LENGTH += nrecords;
 }
 
+/* Gives the id of the call site 'loc', defining it in the trace if new to the thread */
+extern uint32_t _devkit_debug_trace_site_id( DevkitLocation *loc) {
+	size_t hash = ((uintptr_t)loc->file ^ (uintptr_t)loc->function * 31 ^ (size_t)loc->line * 0x9e3779b9);
+	_DevkitTraceSite *cached = &_DEVKIT_TRACE_SITE_CACHE[hash & (DEVKIT_TRACE_SITE_CACHE - 1)];
+	if ( cached->file == loc->file && cached->function == loc->function && cached->line == loc->line)
+		return cached->id;
 
-extern void devkit_debug_update_available() {
-	for (uint32_t probe = 0; probe < UINT32_MAX; ++probe) {
-		if (devkit_debug_pointer_isnull( &DEVKIT_REGISTER.items[probe])) {
-			DEVKIT_REGISTER.available = probe;
-			return;
+	pthread_mutex_lock( &_DEVKIT_TRACE_LOCK);
+	_DevkitTraceSite *site = nullptr;
+	for (size_t idx = 0; idx < _DEVKIT_TRACE_SITES_LENGTH; idx++) {
+		_DevkitTraceSite *known = &_DEVKIT_TRACE_SITES[idx];
+		if ( known->file == loc->file && known->function == loc->function && known->line == loc->line) {
+			site = known;
+			break;
 		}
 	}
-	DEVKIT_REGISTER.available = DEVKIT_REGISTER.size;
+	if (!site) {
+		if ( _DEVKIT_TRACE_SITES_LENGTH == _DEVKIT_TRACE_SITES_CAPACITY) {
+			_DEVKIT_TRACE_SITES_CAPACITY = _DEVKIT_TRACE_SITES_CAPACITY ? 2*_DEVKIT_TRACE_SITES_CAPACITY : 64;
+			_DEVKIT_TRACE_SITES = realloc( _DEVKIT_TRACE_SITES, _DEVKIT_TRACE_SITES_CAPACITY * sizeof(_DevkitTraceSite));
+		}
+		site = &_DEVKIT_TRACE_SITES[_DEVKIT_TRACE_SITES_LENGTH];
+		*site = (_DevkitTraceSite) {
+			.file = loc->file,
+			.function = loc->function,
+			.line = loc->line,
+			.id = (uint32_t)_DEVKIT_TRACE_SITES_LENGTH++
+		};
+	}
+	*cached = *site;
+	pthread_mutex_unlock( &_DEVKIT_TRACE_LOCK);
+
+	// Every thread defines the sites it uses: the analyzer ignores duplicates
+	_devkit_debug_trace_site( cached);
+	return cached->id;
+}
+
+extern void devkit_debug_trace( DevkitTraceOp op, DevkitLocation *loc, void *pointer, size_t size) {
+	uint32_t site = _devkit_debug_trace_site_id( loc);
+	*_devkit_debug_trace_next() = (DevkitTraceRecord) {
+		.timestamp = _devkit_debug_now(),
+		.pointer = (uintptr_t)pointer,
+		.size = size,
+		.site = site,
+		.op = op
+	};
 }
 
 
@@ -152,14 +846,457 @@ extern bool devkit_debug_pointer_isnull( DevkitPointer *this) {
 }
 
 
+/* ZONES IMPLEMENTATION */
+
+DevkitZoneBuffer *_DEVKIT_ZONE_BUFFERS = nullptr;
+uint32_t _DEVKIT_ZONE_THREADS = 0;
+pthread_mutex_t _DEVKIT_ZONE_LOCK = PTHREAD_MUTEX_INITIALIZER;
+_Thread_local DevkitZoneBuffer *_DEVKIT_ZONE_BUFFER = nullptr;
+
+// Reference points of the timestamp counter and the clock, to convert ticks to nanoseconds
+uint64_t _DEVKIT_ZONE_TICKS_ORIGIN, _DEVKIT_ZONE_NS_ORIGIN;
+
+extern uint64_t _devkit_zone_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return _devkit_debug_now();
+#endif
+}
+
+extern void _devkit_zone_export_at_exit() {
+	devkit_zone_export( nullptr);
+}
+
+/* Gives the buffer of the calling thread, creating it at its first zone */
+extern DevkitZoneBuffer* _devkit_zone_buffer() {
+	if ( _DEVKIT_ZONE_BUFFER) return _DEVKIT_ZONE_BUFFER;
+
+	DevkitZoneBuffer *buffer = malloc( sizeof(DevkitZoneBuffer));
+	*buffer = (DevkitZoneBuffer) {
+		.events = malloc( 1024 * sizeof(DevkitZoneEvent)),
+		.capacity = 1024
+	};
+	if ( !buffer->events) {
+		puts("Devkit Debugger: could not allocate a zone buffer!");
+		exit(EXIT_FAILURE);
+	}
+	pthread_mutex_lock( &_DEVKIT_ZONE_LOCK);
+	if ( !_DEVKIT_ZONE_BUFFERS) {
+		_DEVKIT_ZONE_TICKS_ORIGIN = _devkit_zone_ticks();
+		_DEVKIT_ZONE_NS_ORIGIN = _devkit_debug_now();
+		atexit( _devkit_zone_export_at_exit);
+	}
+	buffer->thread = ++_DEVKIT_ZONE_THREADS;
+	buffer->next = _DEVKIT_ZONE_BUFFERS;
+	_DEVKIT_ZONE_BUFFERS = buffer;
+	pthread_mutex_unlock( &_DEVKIT_ZONE_LOCK);
+	return _DEVKIT_ZONE_BUFFER = buffer;
+}
+
+extern void _devkit_zone_record( DevkitZonePhase phase, const char *name,
+		const DevkitLocation *location, double value) {
+	DevkitZoneBuffer *buffer = _devkit_zone_buffer();
+	if ( buffer->length == buffer->capacity) {
+		DevkitZoneEvent *events = realloc( buffer->events, 2 * buffer->capacity * sizeof(DevkitZoneEvent));
+		if (!events) {
+			puts("Devkit Debugger: could not grow a zone buffer!");
+			exit(EXIT_FAILURE);
+		}
+		buffer->events = events;
+		buffer->capacity *= 2;
+	}
+	buffer->events[buffer->length++] = (DevkitZoneEvent) {
+		.ticks = _devkit_zone_ticks(),
+		.name = name,
+		.location = location,
+		.value = value,
+		.phase = phase
+	};
+}
+
+extern DevkitZone _devkit_zone_begin( const char *name, const DevkitLocation *location) {
+	_devkit_zone_record( DEVKIT_ZONE_BEGIN, name, location, 0);
+	return (DevkitZone) { .name = name };
+}
+
+extern void _devkit_zone_end( DevkitZone *zone) {
+	_devkit_zone_record( DEVKIT_ZONE_END, zone->name, nullptr, 0);
+}
+
+extern void devkit_zone_counter( const char *name, double value) {
+	_devkit_zone_record( DEVKIT_ZONE_COUNTER, name, nullptr, value);
+}
+
+/* Writes 'text' as a JSON string */
+extern void _devkit_zone_json( FILE *file, const char *text) {
+	fputc('"', file);
+	for (; text && *text; text++) {
+		if ( *text == '"' || *text == '\\') fprintf( file, "\\%c", *text);
+		else if ( (unsigned char)*text < 0x20) fprintf( file, "\\u%04x", *text);
+		else fputc( *text, file);
+	}
+	fputc('"', file);
+}
+
+extern void devkit_zone_export( const char *path) {
+	if (!path) path = DEVKIT_DEBUGGER_ZONE_FILE;
+	FILE *file = fopen( path, "w");
+	if (!file) {
+		printf("Devkit Debugger: could not open zone file %s!\n", path);
+		return;
+	}
+
+	pthread_mutex_lock( &_DEVKIT_ZONE_LOCK);
+	double ns_per_tick = 1.0;
+#if defined(__x86_64__) || defined(__i386__)
+	uint64_t ticks = _devkit_zone_ticks() - _DEVKIT_ZONE_TICKS_ORIGIN;
+	uint64_t ns = _devkit_debug_now() - _DEVKIT_ZONE_NS_ORIGIN;
+	if ( ticks) ns_per_tick = (double)ns / ticks;
+#endif
+	int pid = getpid();
+	// JSON numbers need '.' whatever the locale of the program
+	locale_t numeric = newlocale( LC_NUMERIC_MASK, "C", (locale_t)0);
+	locale_t previous = numeric ? uselocale( numeric) : (locale_t)0;
+
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+	bool first = true;
+	for (DevkitZoneBuffer *buffer = _DEVKIT_ZONE_BUFFERS; buffer; buffer = buffer->next) {
+		fprintf( file, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%u,"
+				"\"args\":{\"name\":\"thread %u\"}}", first ? "" : ",", pid, buffer->thread, buffer->thread);
+		first = false;
+
+		for (size_t idx = 0; idx < buffer->length; idx++) {
+			DevkitZoneEvent *event = &buffer->events[idx];
+			// Microseconds since the first zone
+			double ts = ((int64_t)(event->ticks - _DEVKIT_ZONE_TICKS_ORIGIN) * ns_per_tick) / 1e3;
+			static const char phases[] = { 'B', 'E', 'C' };
+			fprintf( file, ",\n{\"ph\":\"%c\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"name\":",
+					phases[event->phase], pid, buffer->thread, ts);
+			_devkit_zone_json( file, event->name);
+			if ( event->phase == DEVKIT_ZONE_COUNTER) {
+				fputs(",\"args\":{", file);
+				_devkit_zone_json( file, event->name);
+				// JSON has no NaN nor infinities
+				if ( __builtin_isfinite( event->value)) fprintf( file, ":%.17g}", event->value);
+				else fputs(":null}", file);
+			}
+			else if ( event->location) {
+				fputs(",\"args\":{\"file\":", file);
+				_devkit_zone_json( file, event->location->file);
+				fputs(",\"function\":", file);
+				_devkit_zone_json( file, event->location->function);
+				fprintf( file, ",\"line\":%d}", event->location->line);
+			}
+			fputc('}', file);
+		}
+	}
+	fputs("\n]}\n", file);
+	if ( numeric) {
+		uselocale( previous);
+		freelocale( numeric);
+	}
+	pthread_mutex_unlock( &_DEVKIT_ZONE_LOCK);
+	fclose( file);
+}
+
+
+/* COUNTERS IMPLEMENTATION */
+
+DevkitCounterSite *_DEVKIT_COUNTER_SITES = nullptr;
+pthread_mutex_t _DEVKIT_COUNTER_LOCK = PTHREAD_MUTEX_INITIALIZER;
+// Counters available to at least one thread
+atomic_uint _DEVKIT_COUNTERS_AVAILABLE = 0;
+// Counters that shared the CPU with others at least once, so their counts are estimates
+atomic_uint _DEVKIT_COUNTERS_SCALED = 0;
+pthread_key_t _DEVKIT_COUNTER_KEY;
+pthread_once_t _DEVKIT_COUNTER_ONCE = PTHREAD_ONCE_INIT;
+
+// Counters of the thread: a group led by the first hardware counter that
+// could be opened, and the software ones on their own
+_Thread_local bool _DEVKIT_COUNTERS_OPEN = false;
+_Thread_local int _DEVKIT_COUNTER_FDS[DEVKIT_COUNTER_KINDS];
+_Thread_local int _DEVKIT_COUNTER_LEADER = -1;
+// Counters of the group, in the order the kernel reads them
+_Thread_local DevkitCounterKind _DEVKIT_COUNTER_GROUP[DEVKIT_COUNTER_KINDS];
+_Thread_local size_t _DEVKIT_COUNTER_GROUP_LENGTH = 0;
+
+extern void _devkit_counters_close( void *unused) {
+	(void)unused;
+	for (size_t kind = 0; kind < DEVKIT_COUNTER_KINDS; kind++) {
+		if ( _DEVKIT_COUNTER_FDS[kind] >= 0) close( _DEVKIT_COUNTER_FDS[kind]);
+		_DEVKIT_COUNTER_FDS[kind] = -1;
+	}
+}
+
+extern void _devkit_counters_init() {
+	pthread_key_create( &_DEVKIT_COUNTER_KEY, _devkit_counters_close);
+	atexit( devkit_counters_report);
+}
+
+#ifdef __linux__
+/* Every counter gives its time enabled and running, to scale the counts when
+ * the kernel multiplexes more counters than the CPU has. Only the group leader
+ * is read with PERF_FORMAT_GROUP, the software counters are read on their own */
+extern int _devkit_counter_open( uint32_t type, uint64_t config, int group, bool leader) {
+	struct perf_event_attr attr = {
+		.type = type,
+		.size = sizeof(attr),
+		.config = config,
+		.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+			| (leader ? PERF_FORMAT_GROUP : 0),
+		// Only the thread in user space: allowed without privileges
+		.exclude_kernel = 1,
+		.exclude_hv = 1
+	};
+	return syscall( SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+/* Opens the counters of the calling thread */
+extern void _devkit_counters_open() {
+	pthread_once( &_DEVKIT_COUNTER_ONCE, _devkit_counters_init);
+	_DEVKIT_COUNTERS_OPEN = true;
+	for (size_t kind = 0; kind < DEVKIT_COUNTER_KINDS; kind++) _DEVKIT_COUNTER_FDS[kind] = -1;
+	unsigned available = 0;
+
+#ifdef __linux__
+	static const struct { uint32_t type; uint64_t config; } events[DEVKIT_COUNTER_KINDS] = {
+		[DEVKIT_COUNTER_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		[DEVKIT_COUNTER_INSTRUCTIONS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		[DEVKIT_COUNTER_L1_MISSES] = { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+			| PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+		[DEVKIT_COUNTER_LLC_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		[DEVKIT_COUNTER_BRANCH_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		[DEVKIT_COUNTER_CPU_TIME] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+		[DEVKIT_COUNTER_PAGE_FAULTS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS }
+	};
+	for (size_t kind = 0; kind < DEVKIT_COUNTER_KINDS; kind++) {
+		bool hardware = events[kind].type != PERF_TYPE_SOFTWARE;
+		int fd = _devkit_counter_open( events[kind].type, events[kind].config,
+				hardware ? _DEVKIT_COUNTER_LEADER : -1, hardware && _DEVKIT_COUNTER_LEADER < 0);
+		if ( fd < 0) continue;
+		_DEVKIT_COUNTER_FDS[kind] = fd;
+		available |= 1u << kind;
+		if ( hardware) {
+			if ( _DEVKIT_COUNTER_LEADER < 0) _DEVKIT_COUNTER_LEADER = fd;
+			_DEVKIT_COUNTER_GROUP[_DEVKIT_COUNTER_GROUP_LENGTH++] = kind;
+		}
+	}
+#endif
+	// Without perf_event_open, the thread CPU time and page faults are still known
+	available |= 1u << DEVKIT_COUNTER_CPU_TIME | 1u << DEVKIT_COUNTER_PAGE_FAULTS;
+	atomic_fetch_or( &_DEVKIT_COUNTERS_AVAILABLE, available);
+	pthread_setspecific( _DEVKIT_COUNTER_KEY, &_DEVKIT_COUNTERS_OPEN);
+}
+
+/* Scales 'value' of the counters 'kinds' up to the whole time they were enabled.
+ * Gives false if they never ran */
+extern bool _devkit_counter_scale( uint64_t *value, uint64_t enabled, uint64_t running, unsigned kinds) {
+	if ( !running) return false;
+	if ( running < enabled) {
+		*value = (uint64_t)((double)*value * enabled / running);
+		if ( (atomic_load_explicit( &_DEVKIT_COUNTERS_SCALED, memory_order_relaxed) & kinds) != kinds)
+			atomic_fetch_or( &_DEVKIT_COUNTERS_SCALED, kinds);
+	}
+	return true;
+}
+
+extern unsigned devkit_counters_read( uint64_t values[DEVKIT_COUNTER_KINDS]) {
+	if ( !_DEVKIT_COUNTERS_OPEN) _devkit_counters_open();
+	unsigned available = 0;
+	memset( values, 0, DEVKIT_COUNTER_KINDS * sizeof(uint64_t));
+
+	if ( _DEVKIT_COUNTER_LEADER >= 0) {
+		// Number of counters, time enabled, time running, then the counts
+		uint64_t group[3 + DEVKIT_COUNTER_KINDS];
+		if ( read( _DEVKIT_COUNTER_LEADER, group, sizeof(group)) > 0) {
+			unsigned kinds = 0;
+			for (size_t idx = 0; idx < group[0] && idx < _DEVKIT_COUNTER_GROUP_LENGTH; idx++)
+				kinds |= 1u << _DEVKIT_COUNTER_GROUP[idx];
+			for (size_t idx = 0; idx < group[0] && idx < _DEVKIT_COUNTER_GROUP_LENGTH; idx++) {
+				DevkitCounterKind kind = _DEVKIT_COUNTER_GROUP[idx];
+				values[kind] = group[3 + idx];
+				if ( _devkit_counter_scale( &values[kind], group[1], group[2], kinds))
+					available |= 1u << kind;
+			}
+		}
+	}
+	for (size_t kind = DEVKIT_COUNTER_CPU_TIME; kind < DEVKIT_COUNTER_KINDS; kind++) {
+		// Count, time enabled, time running
+		uint64_t single[3];
+		if ( _DEVKIT_COUNTER_FDS[kind] < 0 || read( _DEVKIT_COUNTER_FDS[kind], single, sizeof(single)) <= 0)
+			continue;
+		values[kind] = single[0];
+		if ( _devkit_counter_scale( &values[kind], single[1], single[2], 1u << kind))
+			available |= 1u << kind;
+	}
+
+	if ( !(available & 1u << DEVKIT_COUNTER_CPU_TIME)) {
+		struct timespec ts;
+		clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts);
+		values[DEVKIT_COUNTER_CPU_TIME] = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+		available |= 1u << DEVKIT_COUNTER_CPU_TIME;
+	}
+	if ( !(available & 1u << DEVKIT_COUNTER_PAGE_FAULTS)) {
+		struct rusage usage;
+#ifdef RUSAGE_THREAD
+		getrusage( RUSAGE_THREAD, &usage);
+#else
+		getrusage( RUSAGE_SELF, &usage);
+#endif
+		values[DEVKIT_COUNTER_PAGE_FAULTS] = usage.ru_minflt + usage.ru_majflt;
+		available |= 1u << DEVKIT_COUNTER_PAGE_FAULTS;
+	}
+	return available;
+}
+
+extern DevkitCounterScope _devkit_counters_begin( DevkitCounterSite *site, size_t elements) {
+	if ( !atomic_load_explicit( &site->registered, memory_order_acquire)) {
+		pthread_mutex_lock( &_DEVKIT_COUNTER_LOCK);
+		if ( !atomic_load_explicit( &site->registered, memory_order_relaxed)) {
+			site->next = _DEVKIT_COUNTER_SITES;
+			_DEVKIT_COUNTER_SITES = site;
+			atomic_store_explicit( &site->registered, true, memory_order_release);
+		}
+		pthread_mutex_unlock( &_DEVKIT_COUNTER_LOCK);
+	}
+	DevkitCounterScope scope = { .site = site, .elements = elements };
+	devkit_counters_read( scope.start);
+	return scope;
+}
+
+extern void _devkit_counters_end( DevkitCounterScope *scope) {
+	uint64_t end[DEVKIT_COUNTER_KINDS];
+	devkit_counters_read( end);
+	DevkitCounterSite *site = scope->site;
+	for (size_t kind = 0; kind < DEVKIT_COUNTER_KINDS; kind++) {
+		// Scaled counts are estimates, that can go back by a little
+		if ( end[kind] > scope->start[kind])
+			atomic_fetch_add_explicit( &site->values[kind], end[kind] - scope->start[kind], memory_order_relaxed);
+	}
+	atomic_fetch_add_explicit( &site->calls, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit( &site->elements, scope->elements, memory_order_relaxed);
+}
+
+extern void devkit_counters_report() {
+	unsigned available = atomic_load( &_DEVKIT_COUNTERS_AVAILABLE);
+	pthread_mutex_lock( &_DEVKIT_COUNTER_LOCK);
+	if ( _DEVKIT_COUNTER_SITES) {
+		puts("-----------------");
+		puts(" Counters:");
+		puts("-----------------");
+	}
+	if ( _DEVKIT_COUNTER_SITES && !(available & 1u << DEVKIT_COUNTER_CYCLES))
+		puts(" Hardware counters are not available, only software ones are shown");
+	if ( _DEVKIT_COUNTER_SITES && atomic_load( &_DEVKIT_COUNTERS_SCALED))
+		puts(" Some counters were multiplexed by the kernel: their counts are estimates");
+
+	for (DevkitCounterSite *site = _DEVKIT_COUNTER_SITES; site; site = site->next) {
+		uint64_t values[DEVKIT_COUNTER_KINDS];
+		for (size_t kind = 0; kind < DEVKIT_COUNTER_KINDS; kind++) values[kind] = atomic_load( &site->values[kind]);
+		size_t calls = atomic_load( &site->calls), elements = atomic_load( &site->elements);
+		double per_element = elements ? 1.0 / elements : 0;
+
+		printf(" %s -> %s:%d (%s)\n", site->name, site->location.file, site->location.line, site->location.function);
+		printf("   %zu calls, %zu elements, %.3f ms of CPU, %lu page faults\n", calls, elements,
+				values[DEVKIT_COUNTER_CPU_TIME] / 1e6, (unsigned long)values[DEVKIT_COUNTER_PAGE_FAULTS]);
+		if ( available & 1u << DEVKIT_COUNTER_CYCLES) {
+			printf("   %lu cycles", (unsigned long)values[DEVKIT_COUNTER_CYCLES]);
+			if ( available & 1u << DEVKIT_COUNTER_INSTRUCTIONS)
+				printf(", %lu instructions, IPC %.2f", (unsigned long)values[DEVKIT_COUNTER_INSTRUCTIONS],
+						values[DEVKIT_COUNTER_CYCLES] ? (double)values[DEVKIT_COUNTER_INSTRUCTIONS] / values[DEVKIT_COUNTER_CYCLES] : 0.0);
+			putchar('\n');
+		}
+		if ( elements) {
+			printf("   per element:");
+			static const struct { DevkitCounterKind kind; const char *name; } shown[] = {
+				{ DEVKIT_COUNTER_CYCLES, "cycles" },
+				{ DEVKIT_COUNTER_INSTRUCTIONS, "instructions" },
+				{ DEVKIT_COUNTER_L1_MISSES, "L1 misses" },
+				{ DEVKIT_COUNTER_LLC_MISSES, "LLC misses" },
+				{ DEVKIT_COUNTER_BRANCH_MISSES, "branch misses" },
+				{ DEVKIT_COUNTER_CPU_TIME, "ns" }
+			};
+			for (size_t idx = 0; idx < sizeof(shown) / sizeof(shown[0]); idx++) {
+				if ( available & 1u << shown[idx].kind)
+					printf(" %.3f %s", values[shown[idx].kind] * per_element, shown[idx].name);
+			}
+			putchar('\n');
+		}
+	}
+	pthread_mutex_unlock( &_DEVKIT_COUNTER_LOCK);
+}
+
+
+/* SAMPLING IMPLEMENTATION */
+#ifdef DEVKIT_DEBUGGER_SAMPLE
+
+/* Draws the bytes to allocate before the next sample. They follow an
+ * exponential distribution, so that samples do not lock onto allocation patterns */
+extern int64_t _devkit_debug_sample_interval() {
+	if ( !_DEVKIT_SAMPLE_STATE)
+		_DEVKIT_SAMPLE_STATE = (_devkit_debug_now() ^ (uintptr_t)&_DEVKIT_SAMPLE_STATE) | 1;
+	// xorshift64*
+	_DEVKIT_SAMPLE_STATE ^= _DEVKIT_SAMPLE_STATE >> 12;
+	_DEVKIT_SAMPLE_STATE ^= _DEVKIT_SAMPLE_STATE << 25;
+	_DEVKIT_SAMPLE_STATE ^= _DEVKIT_SAMPLE_STATE >> 27;
+	double uniform = (_DEVKIT_SAMPLE_STATE * 0x2545f4914f6cdd1dULL >> 11) * 0x1p-53;
+	return (int64_t)(-log( 1.0 - uniform) * DEVKIT_SAMPLE_RATE) + 1;
+}
+
+/* Tells if an allocation of 'size' bytes is sampled, and in that case gives in
+ * 'weight' the bytes it stands for: 'size' divided by the chance of sampling it */
+extern bool _devkit_debug_sampled( size_t size, size_t *weight) {
+	_DEVKIT_SAMPLE_COUNTDOWN -= size;
+	if ( __builtin_expect( _DEVKIT_SAMPLE_COUNTDOWN > 0, true)) return false;
+
+	if ( !_DEVKIT_SAMPLE_STATE) {
+		// First allocation of the thread: the countdown was never drawn
+		_DEVKIT_SAMPLE_COUNTDOWN = _devkit_debug_sample_interval() - size;
+		if ( _DEVKIT_SAMPLE_COUNTDOWN > 0) return false;
+	}
+	_DEVKIT_SAMPLE_COUNTDOWN = _devkit_debug_sample_interval();
+	double chance = 1.0 - exp( -(double)size / DEVKIT_SAMPLE_RATE);
+	*weight = chance > 0 ? (size_t)(size / chance + 0.5) : size;
+	return true;
+}
+
+extern atomic_uint* _devkit_debug_sample_filter( void *pointer) {
+	return &_DEVKIT_SAMPLE_FILTER[_devkit_debug_hash( pointer) & (DEVKIT_SAMPLE_FILTER_SLOTS - 1)];
+}
+
+extern void _devkit_debug_sample_register( DevkitLocation *loc, void *pointer, size_t size) {
+	size_t weight;
+	if ( !_devkit_debug_sampled( size, &weight)) return;
+	atomic_fetch_add_explicit( _devkit_debug_sample_filter( pointer), 1, memory_order_relaxed);
+	devkit_debug_register_weighted( loc, pointer, size, weight);
+}
+
+extern void _devkit_debug_sample_unregister( void *pointer) {
+	atomic_uint *filter = _devkit_debug_sample_filter( pointer);
+	// Most pointers were not sampled: no need to look them up
+	if ( !atomic_load_explicit( filter, memory_order_relaxed)) return;
+	if ( devkit_debug_unregister_ptr( pointer, nullptr))
+		atomic_fetch_sub_explicit( filter, 1, memory_order_relaxed);
+}
+#endif
+
+
 extern void* devkit_debug_allocate( DevkitLocation loc, size_t size) {
 	void *allocation = malloc( size);
 	if (!allocation) {
 		DEVKIT_DEBUGGER_WARN(&loc, DEVKIT_DEBUGGER_ALLOC_FAIL(size));
 		exit(EXIT_FAILURE);
 	}
+#if defined(DEVKIT_DEBUGGER_TRACE)
+	devkit_debug_trace( DEVKIT_TRACE_MALLOC, &loc, allocation, size);
+#elif defined(DEVKIT_DEBUGGER_SAMPLE)
+	_devkit_debug_sample_register( &loc, allocation, size);
+#else
 	DEVKIT_DEBUGGER_PRINT(&loc, "%lu bytes allocated at %p", size, allocation);
 	devkit_debug_register_ptr(&loc, allocation, size);
+#endif
 
 	return allocation;
 }
@@ -170,33 +1307,41 @@ extern void* devkit_debug_callocate( DevkitLocation loc, size_t nmemb, size_t si
 		DEVKIT_DEBUGGER_PRINTINFO(&loc, DEVKIT_DEBUGGER_ALLOC_FAIL(size));
 		exit(1);
 	}
+#if defined(DEVKIT_DEBUGGER_TRACE)
+	devkit_debug_trace( DEVKIT_TRACE_CALLOC, &loc, allocation, nmemb*size);
+#elif defined(DEVKIT_DEBUGGER_SAMPLE)
+	_devkit_debug_sample_register( &loc, allocation, nmemb*size);
+#else
 	DEVKIT_DEBUGGER_PRINT(&loc, "cluster of %lu × %lu bytes allocated at %p",
 			nmemb, size, allocation);
 	devkit_debug_register_ptr(&loc, allocation, nmemb*size);
+#endif
 
 	return allocation;
 }
 
 extern void devkit_debug_free( DevkitLocation loc, void *pointer) {
+#ifdef DEVKIT_DEBUGGER_TRACE
+	// Traced before freeing, so that it comes before any new allocation at the same address
+	if (pointer) devkit_debug_trace( DEVKIT_TRACE_FREE, &loc, pointer, 0);
+	free(pointer);
+	return;
+#elif defined(DEVKIT_DEBUGGER_SAMPLE)
+	if (pointer) _devkit_debug_sample_unregister( pointer);
+	free(pointer);
+	return;
+#endif
 	if (!pointer) {
 		DEVKIT_DEBUGGER_WARN(&loc, DEVKIT_DEBUGGER_NULLPTR_WARNING);
 	}
 
-	// Find pointer in register
-	size_t slot = 0;
-	while (slot < DEVKIT_REGISTER.size && 
-			(DEVKIT_REGISTER.items[slot].pointer != pointer ||
-			devkit_debug_pointer_isnull( &DEVKIT_REGISTER.items[slot]) )) {
-		++slot;
-	}
+	// Remove pointer from register before freeing it, so that no other
+	// thread can get the same address and register it in the meantime
+	DevkitPointer ptr_data;
 	// Print info about pointer if in register, otherwise print a warning
-	if ( slot != DEVKIT_REGISTER.size) {
-		DevkitPointer ptr_data = DEVKIT_REGISTER.items[slot];
+	if ( devkit_debug_unregister_ptr( pointer, &ptr_data)) {
 		DEVKIT_DEBUGGER_PRINT(&loc, "freeing pointer %p of size %lu", 
 			ptr_data.pointer, ptr_data.size);
-		// Remove freed pointer from register
-		DEVKIT_REGISTER.items[slot] = DEVKIT_POINTER_NULL;
-		devkit_debug_update_available();
 	}
 	// Print warning
 	else {
@@ -207,11 +1352,37 @@ extern void devkit_debug_free( DevkitLocation loc, void *pointer) {
 }
 
 
+#define _DEVKIT_ZONE_CONCAT2(a, b) a##b
+#define _DEVKIT_ZONE_CONCAT(a, b) _DEVKIT_ZONE_CONCAT2(a, b)
+
+#ifndef DEVKIT_DEBUGGER_NO_ZONES
+/* Times the rest of the enclosing block as the zone 'name' */
+#define DEVKIT_ZONE(name) \
+	static const DevkitLocation _DEVKIT_ZONE_CONCAT(_devkit_zone_location_, __LINE__) = { \
+		.file = __FILE__, .function = __func__, .line = __LINE__ }; \
+	__attribute__((cleanup(_devkit_zone_end))) DevkitZone _DEVKIT_ZONE_CONCAT(_devkit_zone_, __LINE__) = \
+		_devkit_zone_begin( (name), &_DEVKIT_ZONE_CONCAT(_devkit_zone_location_, __LINE__))
+#define DEVKIT_ZONE_COUNTER(name, value) devkit_zone_counter( (name), (double)(value))
+
+/* Counts the events of the rest of the enclosing block, which handles '_elements' items */
+#define DEVKIT_COUNTERS(_name, _elements) \
+	static DevkitCounterSite _DEVKIT_ZONE_CONCAT(_devkit_counter_site_, __LINE__) = { \
+		.name = (_name), .location = { .file = __FILE__, .function = __func__, .line = __LINE__ } }; \
+	__attribute__((cleanup(_devkit_counters_end))) DevkitCounterScope _DEVKIT_ZONE_CONCAT(_devkit_counters_, __LINE__) = \
+		_devkit_counters_begin( &_DEVKIT_ZONE_CONCAT(_devkit_counter_site_, __LINE__), (_elements))
+#else
+#define DEVKIT_ZONE(name)
+#define DEVKIT_ZONE_COUNTER(name, value)
+#define DEVKIT_COUNTERS(name, elements)
+#endif
+
+#ifndef DEVKIT_DEBUGGER_NO_MACROS
 #define malloc(size) \
 	devkit_debug_allocate( DEVKIT_LOCATION_PTR( __FILE__, __FUNCTION__, __LINE__), (size))
 #define calloc(nmemb, size) \
 	devkit_debug_callocate( DEVKIT_LOCATION_PTR( __FILE__, __FUNCTION__, __LINE__), (nmemb), (size))
 #define free(ptr) \
 	devkit_debug_free( DEVKIT_LOCATION_PTR( __FILE__, __FUNCTION__, __LINE__), (ptr))
+#endif
 
 #endif
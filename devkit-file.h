@@ -0,0 +1,1055 @@
+#ifndef _DEVKIT_FILE_H
+#define _DEVKIT_FILE_H
+
+// Needed by 'mmap', 'madvise' and 'pread' when compiling in strict ISO mode
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#if defined(__STDC__) && __STDC__ < 202311L
+#define nullptr NULL
+#include <stdbool.h>
+#endif
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if defined(__linux__) && !defined(DEVKIT_FILE_NO_URING) && __has_include(<linux/io_uring.h>)
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#endif
+
+#include "devkit.h"
+
+
+/*
+ * ###############
+ * # DEVKIT FILE #
+ * ###############
+ */
+
+/* Files smaller than this are read instead of mapped: for them, setting up
+ * the mapping costs more than copying */
+#ifndef DEVKIT_FILE_MMAP_MIN
+#define DEVKIT_FILE_MMAP_MIN (16 * 1024)
+#endif
+
+/* Bytes read at a time from files that cannot be mapped (pipes, terminals...) */
+#define DEVKIT_FILE_READ_CHUNK (64 * 1024)
+
+#ifdef DEVKIT_STRIP_PREFIXES
+#define string_mmap devkit_string_mmap
+#define string_lines devkit_string_lines
+#define string_next_line devkit_string_next_line
+#endif
+
+
+/* Gives the content of the file at 'path', or null (with errno set) if it cannot be read.
+ * Regular files are mapped read-only instead of copied: pages are loaded when first
+ * touched, and the kernel is told they will be read in order. Other files are read.
+ * The characters must not be modified, and the file must not shrink while mapped.
+ * Free the string with 'devkit_string_free' */
+extern DevkitString* devkit_string_mmap( const char *path);
+
+/* Splits 'text' in lines, without their "\n" or "\r\n" */
+extern DevkitStringSplit devkit_string_lines( DevkitStringView text);
+/* Gives a view of the next line in 'line'. Returns false when there are no more lines.
+ * A "\n" at the end of the text does not start another line */
+extern bool devkit_string_next_line( DevkitStringSplit *lines, DevkitStringView *line);
+
+extern DevkitStringView _devkit_view_of_view( DevkitStringView view);
+
+/* Views 'text', that can be a DevkitString* or a DevkitStringView */
+#define _devkit_text_view( text) _Generic( (text), \
+		DevkitString*: devkit_string_view, \
+		const DevkitString*: devkit_string_view, \
+		DevkitStringView: _devkit_view_of_view \
+		)( text)
+
+/* Runs the code after 'text' for every line of 'text' (a DevkitString* or a DevkitStringView),
+ * with the line in the DevkitStringView 'var'. Lines are not copied. Unlike 'foreach',
+ * 'break' can be used */
+#define foreach_line( var, text, ...) { \
+	DevkitStringSplit _devkit_lines = devkit_string_lines( _devkit_text_view(text)); \
+	DevkitStringView var; \
+	while ( devkit_string_next_line( &_devkit_lines, &var)) { __VA_ARGS__; } \
+}
+
+
+/*
+ * ##########################
+ * # DEVKIT READER / WRITER #
+ * ##########################
+ */
+
+/* Buffered streams over a file descriptor. Unlike stdio they do not lock at every
+ * call and give views into their buffer instead of copying. Not thread-safe */
+
+/* Bytes buffered when no capacity is given */
+#define DEVKIT_FILE_BUFFER (1024 * 1024)
+
+typedef struct {
+	int fd;
+	char *items; // Buffer
+	size_t capacity;
+	size_t start, end; // Bytes read from the file but not given yet
+	bool eof, error; // 'error' is set if a read failed, with errno
+} DevkitReader;
+
+typedef struct {
+	int fd;
+	char *items; // Buffer
+	size_t length, capacity;
+	bool error; // Set if a write failed, with errno
+} DevkitWriter;
+
+#ifdef DEVKIT_STRIP_PREFIXES
+typedef DevkitReader Reader;
+typedef DevkitWriter Writer;
+
+#define file_open devkit_file_open
+#define reader_open devkit_reader_open
+#define reader_fd devkit_reader_fd
+#define reader_read devkit_reader_read
+#define reader_chunk devkit_reader_chunk
+#define reader_until devkit_reader_until
+#define reader_line devkit_reader_line
+#define reader_close devkit_reader_close
+#define writer_open devkit_writer_open
+#define writer_fd devkit_writer_fd
+#define writer_write devkit_writer_write
+#define writer_write_char devkit_writer_write_char
+#define writer_write_view devkit_writer_write_view
+#define writer_write_string devkit_writer_write_string
+#define writer_write_list devkit_writer_write_list
+#define writer_write_array devkit_writer_write_array
+#define writer_write_int devkit_writer_write_int
+#define writer_write_double devkit_writer_write_double
+#define writer_flush devkit_writer_flush
+#define writer_close devkit_writer_close
+#endif
+
+
+/* Opens the file at 'path' with one of the F_* modes of devkit.h ("r", "wb", "a+"...),
+ * creating it if the mode writes. Returns the file descriptor, or -1 with errno set */
+extern int devkit_file_open( const char *path, const char *mode);
+
+/* Opens a reader of the file at 'path' with a reading F_* mode and a buffer of 'capacity'
+ * bytes (DEVKIT_FILE_BUFFER if 0). Returns null, with errno set, if the file cannot be opened */
+extern DevkitReader* devkit_reader_open( const char *path, const char *mode, size_t capacity);
+/* Same as 'devkit_reader_open', on the open file 'fd'. Closing the reader closes 'fd' */
+extern DevkitReader* devkit_reader_fd( int fd, size_t capacity);
+
+/* Copies the next 'nbytes' bytes into 'dest'. Returns the bytes copied, fewer at the end of the file.
+ * Big reads go straight into 'dest' */
+extern size_t devkit_reader_read( DevkitReader *reader, void *dest, size_t nbytes);
+/* Gives a view of all the bytes in the buffer, reading more if it is empty.
+ * Returns false at the end of the file */
+extern bool devkit_reader_chunk( DevkitReader *reader, DevkitStringView *chunk);
+/* Gives a view of the bytes before the next 'delimiter', which is skipped. The last token
+ * of the file may have no delimiter. Returns false at the end of the file.
+ * The buffer grows if a token does not fit in it */
+extern bool devkit_reader_until( DevkitReader *reader, char delimiter, DevkitStringView *token);
+/* Same as 'devkit_reader_until' with "\n", also dropping a "\r" before it */
+extern bool devkit_reader_line( DevkitReader *reader, DevkitStringView *line);
+/* Views given by the reader are valid until its next call */
+
+/* Closes the file and frees 'reader' */
+extern void devkit_reader_close( DevkitReader *reader);
+
+
+/* Opens a writer of the file at 'path' with a writing F_* mode and a buffer of 'capacity'
+ * bytes (DEVKIT_FILE_BUFFER if 0). Returns null, with errno set, if the file cannot be opened */
+extern DevkitWriter* devkit_writer_open( const char *path, const char *mode, size_t capacity);
+/* Same as 'devkit_writer_open', on the open file 'fd'. Closing the writer closes 'fd' */
+extern DevkitWriter* devkit_writer_fd( int fd, size_t capacity);
+
+/* Writes 'nbytes' bytes of 'data'. Writes bigger than the buffer are not copied into it */
+extern void devkit_writer_write( DevkitWriter *writer, const void *data, size_t nbytes);
+extern void devkit_writer_write_char( DevkitWriter *writer, char c);
+extern void devkit_writer_write_view( DevkitWriter *writer, DevkitStringView view);
+extern void devkit_writer_write_string( DevkitWriter *writer, const DevkitString *s);
+/* Write the items of a list or an array as they are in memory */
+extern void devkit_writer_write_list( DevkitWriter *writer, const DevkitList *list);
+extern void devkit_writer_write_array( DevkitWriter *writer, const DevkitArray *array);
+/* Write a number as text (see 'devkit_format_int' and 'devkit_format_double') */
+extern void devkit_writer_write_int( DevkitWriter *writer, long long value);
+extern void devkit_writer_write_double( DevkitWriter *writer, double value);
+
+/* Writes the buffer to the file. Returns false if a write failed */
+extern bool devkit_writer_flush( DevkitWriter *writer);
+/* Flushes and closes the file and frees 'writer'. Returns false if a write failed */
+extern bool devkit_writer_close( DevkitWriter *writer);
+
+
+/*
+ * #######################
+ * # DEVKIT FILE LOADER #
+ * #######################
+ */
+
+/* Loads many files at once. On Linux the opens, reads and closes of all the files are
+ * queued together with io_uring, so the disk always has work and there are few system
+ * calls. Where io_uring is unavailable (or DEVKIT_FILE_NO_URING is defined), a pool of
+ * threads reads them with 'pread' */
+
+#if defined(__linux__) && !defined(DEVKIT_FILE_NO_URING) && __has_include(<linux/io_uring.h>)
+#define DEVKIT_FILE_URING
+#endif
+
+/* Threads reading files when io_uring is unavailable */
+#ifndef DEVKIT_FILE_THREADS
+#define DEVKIT_FILE_THREADS 16
+#endif
+
+/* Operations queued at once in io_uring (half as many files) */
+#define DEVKIT_FILE_RING_ENTRIES 256
+
+#ifdef DEVKIT_STRIP_PREFIXES
+#define files_load devkit_files_load
+#define files_load_arrays devkit_files_load_arrays
+#define files_list devkit_files_list
+#endif
+
+
+/* Loads the 'nfiles' files at 'paths' into strings, each in 'dest' at the same index,
+ * filled as the reads complete. Files that cannot be read give null (errno is set to the
+ * error of the last one). Returns the files loaded. Free the strings with 'devkit_string_free' */
+extern size_t devkit_files_load( size_t nfiles, const char *const paths[], DevkitString *dest[]);
+/* Same as 'devkit_files_load', loading the files into arrays of char */
+extern size_t devkit_files_load_arrays( size_t nfiles, const char *const paths[], DevkitArray *dest[]);
+
+/* Adds to 'dest', a list of char*, the paths of the regular files in the directory tree
+ * at 'path'. Paths are allocated with malloc. Returns false if 'path' cannot be read */
+extern bool devkit_files_list( DevkitList *dest, const char *path);
+
+
+
+
+/* IMPLEMENTATION */
+
+#define DEVKIT_FILE_IMPLEMENTATION
+#ifdef DEVKIT_FILE_IMPLEMENTATION
+
+DevkitStringView _devkit_view_of_view( DevkitStringView view) {
+	return view;
+}
+
+/* A mapped string lives in its own region: a page for the struct, then the pages
+ * of the file and at least one zero byte after them, the null terminator */
+size_t _devkit_mmap_size( size_t length) {
+	size_t page = sysconf( _SC_PAGESIZE);
+	return page + (length + 1 + page - 1) / page * page;
+}
+
+void* _devkit_mmap_allocate( void *context, size_t size) {
+	(void)context;
+	(void)size;
+	assert( false && "devkit_string_mmap: mapped strings cannot allocate!!!");
+	return nullptr;
+}
+
+void* _devkit_mmap_reallocate( void *context, void *ptr, size_t old_size, size_t new_size) {
+	(void)context;
+	(void)ptr;
+	(void)old_size;
+	(void)new_size;
+	assert( false && "devkit_string_mmap: mapped strings cannot grow!!!");
+	return nullptr;
+}
+
+/* 'devkit_string_free' gives back the struct and the characters after it: unmap the region */
+void _devkit_mmap_deallocate( void *context, void *ptr, size_t size) {
+	(void)context;
+	munmap( ptr, _devkit_mmap_size( size - sizeof(DevkitString) - 1));
+}
+
+const DevkitAllocator _DEVKIT_MMAP_ALLOCATOR = {
+	.allocate = _devkit_mmap_allocate,
+	.reallocate = _devkit_mmap_reallocate,
+	.deallocate = _devkit_mmap_deallocate,
+	.context = nullptr
+};
+
+
+/* Turns 'buffer', holding 'length' characters after room for the struct and at
+ * least one spare byte, into a string. The buffer is only ever shrunk: if that
+ * fails, the string keeps it whole */
+DevkitString* _devkit_file_string( char *buffer, size_t length) {
+	DevkitString *s = (DevkitString*)buffer, *shrunk;
+	if ( length <= DEVKIT_STRING_INLINE) {
+		memmove( s->inline_items, buffer + sizeof(DevkitString), length);
+		s->inline_items[length] = '\0';
+		if ( (shrunk = realloc( s, sizeof(DevkitString)))) s = shrunk;
+	}
+	else {
+		if ( (shrunk = realloc( s, sizeof(DevkitString) + length + 1))) s = shrunk;
+		s->heap_items = (char*)(s + 1);
+		s->heap_items[length] = '\0';
+	}
+	s->length = length;
+	s->allocator = nullptr;
+	s->on_heap = true;
+	return s;
+}
+
+/* Reads 'fd' until its end into a string, with its characters right after the struct.
+ * 'size' is the expected length, 0 if unknown */
+DevkitString* _devkit_file_read( int fd, size_t size) {
+	// One more byte than expected, so that the end is found without growing
+	size_t capacity = size ? size + 1 : DEVKIT_FILE_READ_CHUNK, length = 0;
+	char *buffer = malloc( sizeof(DevkitString) + capacity + 1);
+	if (!buffer) return nullptr;
+
+	for (;;) {
+		if ( length == capacity) {
+			capacity *= 2;
+			char *grown = realloc( buffer, sizeof(DevkitString) + capacity + 1);
+			if (!grown) {
+				free( buffer);
+				return nullptr;
+			}
+			buffer = grown;
+		}
+		ssize_t nread = read( fd, buffer + sizeof(DevkitString) + length, capacity - length);
+		if ( nread == 0) break;
+		if ( nread < 0) {
+			if ( errno == EINTR) continue;
+			free( buffer);
+			return nullptr;
+		}
+		length += nread;
+	}
+
+	return _devkit_file_string( buffer, length);
+}
+
+
+/* Maps the 'length' bytes of 'fd', or gives null if it cannot */
+DevkitString* _devkit_file_map( int fd, size_t length) {
+	size_t page = sysconf( _SC_PAGESIZE), size = _devkit_mmap_size( length);
+
+	// Reserve zeroed memory for the whole region, then put the file over it
+	char *region = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ( region == MAP_FAILED) return nullptr;
+	char *items = mmap( region + page, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+	if ( items == MAP_FAILED) {
+		munmap( region, size);
+		return nullptr;
+	}
+	madvise( items, length, MADV_SEQUENTIAL);
+
+	DevkitString *s = (DevkitString*)region;
+	s->heap_items = items;
+	s->length = length;
+	s->allocator = &_DEVKIT_MMAP_ALLOCATOR;
+	s->on_heap = true;
+	return s;
+}
+
+DevkitString* devkit_string_mmap( const char *path) {
+	int fd = open( path, O_RDONLY | O_CLOEXEC);
+	if ( fd < 0) return nullptr;
+
+	struct stat info;
+	if ( fstat( fd, &info) < 0) {
+		close( fd);
+		return nullptr;
+	}
+
+	DevkitString *s = nullptr;
+	bool regular = S_ISREG(info.st_mode);
+	if ( regular && info.st_size >= DEVKIT_FILE_MMAP_MIN && info.st_size > DEVKIT_STRING_INLINE)
+		s = _devkit_file_map( fd, info.st_size);
+	// Pipes and the like have no size, small files are cheaper to copy
+	if (!s) s = _devkit_file_read( fd, regular ? info.st_size : 0);
+
+	int error = errno;
+	close( fd);
+	errno = error;
+	return s;
+}
+
+
+DevkitStringSplit devkit_string_lines( DevkitStringView text) {
+	return devkit_string_view_split( text, '\n');
+}
+
+bool devkit_string_next_line( DevkitStringSplit *lines, DevkitStringView *line) {
+	if ( lines->position >= lines->length) return false;
+	devkit_string_split_next( lines, line);
+	if ( line->length && line->items[line->length - 1] == '\r') --line->length;
+	return true;
+}
+
+
+int devkit_file_open( const char *path, const char *mode) {
+	int flags;
+	switch ( mode[0]) {
+		case 'r': flags = O_RDONLY; break;
+		case 'w': flags = O_WRONLY | O_CREAT | O_TRUNC; break;
+		case 'a': flags = O_WRONLY | O_CREAT | O_APPEND; break;
+		default:
+			errno = EINVAL;
+			return -1;
+	}
+	// 'b' makes no difference on POSIX systems
+	if ( strchr( mode, '+')) flags = (flags & ~(O_RDONLY | O_WRONLY)) | O_RDWR;
+	return open( path, flags | O_CLOEXEC, 0666);
+}
+
+
+DevkitReader* devkit_reader_open( const char *path, const char *mode, size_t capacity) {
+	assert( (mode[0] == 'r' || strchr( mode, '+')) && "DevkitReader: not a reading mode!!!");
+	int fd = devkit_file_open( path, mode);
+	if ( fd < 0) return nullptr;
+	posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	return devkit_reader_fd( fd, capacity);
+}
+
+DevkitReader* devkit_reader_fd( int fd, size_t capacity) {
+	if (!capacity) capacity = DEVKIT_FILE_BUFFER;
+	DevkitReader *reader = malloc( sizeof(*reader));
+	assert( reader && "DevkitReader: could not allocate reader!!!");
+	*reader = (DevkitReader) {
+		.fd = fd,
+		.items = malloc( capacity),
+		.capacity = capacity
+	};
+	assert( reader->items && "DevkitReader: could not allocate buffer!!!");
+	return reader;
+}
+
+/* Reads more of the file after the bytes not given yet, moving them to the start of
+ * the buffer if there is little room left after them, or growing the buffer if full.
+ * Returns false at the end of the file */
+bool _devkit_reader_fill( DevkitReader *reader) {
+	if ( reader->eof) return false;
+
+	size_t unread = reader->end - reader->start;
+	if ( reader->start == reader->end) reader->start = reader->end = 0;
+	else if ( reader->capacity - reader->end < reader->capacity / 2) {
+		memmove( reader->items, reader->items + reader->start, unread);
+		reader->start = 0, reader->end = unread;
+	}
+	if ( reader->end == reader->capacity) {
+		reader->capacity *= 2;
+		reader->items = realloc( reader->items, reader->capacity);
+		assert( reader->items && "DevkitReader: could not grow buffer!!!");
+	}
+
+	for (;;) {
+		ssize_t nread = read( reader->fd, reader->items + reader->end, reader->capacity - reader->end);
+		if ( nread > 0) {
+			reader->end += nread;
+			return true;
+		}
+		if ( nread < 0 && errno == EINTR) continue;
+		if ( nread < 0) reader->error = true;
+		reader->eof = true;
+		return false;
+	}
+}
+
+size_t devkit_reader_read( DevkitReader *reader, void *dest, size_t nbytes) {
+	char *bytes = dest;
+	size_t copied = 0;
+	while ( copied < nbytes) {
+		size_t buffered = reader->end - reader->start;
+		if ( buffered) {
+			size_t ncopy = buffered < nbytes - copied ? buffered : nbytes - copied;
+			memcpy( bytes + copied, reader->items + reader->start, ncopy);
+			reader->start += ncopy, copied += ncopy;
+			continue;
+		}
+		if ( reader->eof) break;
+
+		// The buffer is empty: big reads skip it
+		if ( nbytes - copied >= reader->capacity) {
+			ssize_t nread = read( reader->fd, bytes + copied, nbytes - copied);
+			if ( nread > 0) copied += nread;
+			else if ( nread < 0 && errno == EINTR) continue;
+			else {
+				reader->error = nread < 0;
+				reader->eof = true;
+			}
+		}
+		else _devkit_reader_fill( reader);
+	}
+	return copied;
+}
+
+bool devkit_reader_chunk( DevkitReader *reader, DevkitStringView *chunk) {
+	if ( reader->start == reader->end && !_devkit_reader_fill( reader)) return false;
+	*chunk = (DevkitStringView) { .items = reader->items + reader->start, .length = reader->end - reader->start };
+	reader->start = reader->end;
+	return true;
+}
+
+bool devkit_reader_until( DevkitReader *reader, char delimiter, DevkitStringView *token) {
+	// Bytes already searched are not searched again after a refill
+	size_t searched = 0;
+	for (;;) {
+		DevkitStringView unread = {
+			.items = reader->items + reader->start,
+			.length = reader->end - reader->start
+		};
+		size_t found = devkit_string_view_find_char( unread, delimiter, searched);
+		if ( found != DEVKIT_STRING_NOT_FOUND) {
+			*token = devkit_string_view_slice( unread, 0, found);
+			reader->start += found + 1;
+			return true;
+		}
+		searched = unread.length;
+		if ( !_devkit_reader_fill( reader)) {
+			if ( !unread.length) return false;
+			*token = unread;
+			reader->start = reader->end;
+			return true;
+		}
+	}
+}
+
+bool devkit_reader_line( DevkitReader *reader, DevkitStringView *line) {
+	if ( !devkit_reader_until( reader, '\n', line)) return false;
+	if ( line->length && line->items[line->length - 1] == '\r') --line->length;
+	return true;
+}
+
+void devkit_reader_close( DevkitReader *reader) {
+	if (!reader) return;
+	close( reader->fd);
+	free( reader->items);
+	free( reader);
+}
+
+
+DevkitWriter* devkit_writer_open( const char *path, const char *mode, size_t capacity) {
+	assert( (mode[0] == 'w' || mode[0] == 'a' || strchr( mode, '+')) && "DevkitWriter: not a writing mode!!!");
+	int fd = devkit_file_open( path, mode);
+	if ( fd < 0) return nullptr;
+	return devkit_writer_fd( fd, capacity);
+}
+
+DevkitWriter* devkit_writer_fd( int fd, size_t capacity) {
+	if (!capacity) capacity = DEVKIT_FILE_BUFFER;
+	DevkitWriter *writer = malloc( sizeof(*writer));
+	assert( writer && "DevkitWriter: could not allocate writer!!!");
+	*writer = (DevkitWriter) {
+		.fd = fd,
+		.items = malloc( capacity),
+		.capacity = capacity
+	};
+	assert( writer->items && "DevkitWriter: could not allocate buffer!!!");
+	return writer;
+}
+
+/* Writes all the 'nbytes' of 'data' to the file, retrying after partial writes */
+void _devkit_writer_write_all( DevkitWriter *writer, const char *data, size_t nbytes) {
+	while ( nbytes && !writer->error) {
+		ssize_t nwritten = write( writer->fd, data, nbytes);
+		if ( nwritten < 0) {
+			if ( errno != EINTR) writer->error = true;
+			continue;
+		}
+		data += nwritten, nbytes -= nwritten;
+	}
+}
+
+bool devkit_writer_flush( DevkitWriter *writer) {
+	_devkit_writer_write_all( writer, writer->items, writer->length);
+	writer->length = 0;
+	return !writer->error;
+}
+
+void devkit_writer_write( DevkitWriter *writer, const void *data, size_t nbytes) {
+	if ( writer->length + nbytes <= writer->capacity) {
+		memcpy( writer->items + writer->length, data, nbytes);
+		writer->length += nbytes;
+		return;
+	}
+	devkit_writer_flush( writer);
+	if ( nbytes >= writer->capacity) _devkit_writer_write_all( writer, data, nbytes);
+	else {
+		memcpy( writer->items, data, nbytes);
+		writer->length = nbytes;
+	}
+}
+
+void devkit_writer_write_char( DevkitWriter *writer, char c) {
+	if ( writer->length == writer->capacity) devkit_writer_flush( writer);
+	writer->items[writer->length++] = c;
+}
+
+void devkit_writer_write_view( DevkitWriter *writer, DevkitStringView view) {
+	devkit_writer_write( writer, view.items, view.length);
+}
+
+void devkit_writer_write_string( DevkitWriter *writer, const DevkitString *s) {
+	devkit_writer_write( writer, devkit_string_items(s), s->length);
+}
+
+void devkit_writer_write_list( DevkitWriter *writer, const DevkitList *list) {
+	devkit_writer_write( writer, list->items, list->length*list->typesize);
+}
+
+void devkit_writer_write_array( DevkitWriter *writer, const DevkitArray *array) {
+	devkit_writer_write( writer, array->items, array->length*array->typesize);
+}
+
+void devkit_writer_write_int( DevkitWriter *writer, long long value) {
+	if ( writer->capacity - writer->length < DEVKIT_NUMBER_CHARS) devkit_writer_flush( writer);
+	if ( writer->capacity < DEVKIT_NUMBER_CHARS) {
+		char digits[DEVKIT_NUMBER_CHARS];
+		devkit_writer_write( writer, digits, devkit_format_int( digits, value));
+	}
+	else writer->length += devkit_format_int( writer->items + writer->length, value);
+}
+
+void devkit_writer_write_double( DevkitWriter *writer, double value) {
+	if ( writer->capacity - writer->length < DEVKIT_NUMBER_CHARS) devkit_writer_flush( writer);
+	if ( writer->capacity < DEVKIT_NUMBER_CHARS) {
+		char digits[DEVKIT_NUMBER_CHARS];
+		devkit_writer_write( writer, digits, devkit_format_double( digits, value));
+	}
+	else writer->length += devkit_format_double( writer->items + writer->length, value);
+}
+
+bool devkit_writer_close( DevkitWriter *writer) {
+	bool written = devkit_writer_flush( writer);
+	if ( close( writer->fd) < 0) written = false;
+	free( writer->items);
+	free( writer);
+	return written;
+}
+
+
+/* A file being loaded. Its bytes are read after 'header' bytes, where the struct
+ * of the string or the array is put at the end */
+typedef struct {
+	const char *path;
+	char *buffer;
+	size_t header;
+	size_t length, capacity;
+	int fd, error;
+#ifdef DEVKIT_FILE_URING
+	struct statx stat;
+	enum { _DEVKIT_LOAD_OPENING, _DEVKIT_LOAD_READING, _DEVKIT_LOAD_CLOSING } phase;
+	unsigned pending; // Operations in the ring
+#endif
+} _DevkitLoad;
+
+/* Reads the file of 'load' from 'fd' until its 'size' bytes are read or, if 'size'
+ * is 0 (unknown), until its end. Files of known size are read with 'pread', the
+ * others (pipes, /proc...) with 'read', as they may not seek. Returns false on errors */
+bool _devkit_load_pread( _DevkitLoad *load, int fd, size_t size) {
+	load->capacity = size ? size : DEVKIT_FILE_READ_CHUNK;
+	load->buffer = malloc( load->header + load->capacity + 1);
+	if (!load->buffer) return (load->error = ENOMEM), false;
+
+	while ( !size || load->length < size) {
+		if ( load->length == load->capacity) {
+			load->capacity *= 2;
+			char *grown = realloc( load->buffer, load->header + load->capacity + 1);
+			if (!grown) return (load->error = ENOMEM), false;
+			load->buffer = grown;
+		}
+		char *dest = load->buffer + load->header + load->length;
+		size_t rest = load->capacity - load->length;
+		ssize_t nread = size ? pread( fd, dest, rest, load->length) : read( fd, dest, rest);
+		if ( nread == 0) break;
+		if ( nread < 0) {
+			if ( errno == EINTR) continue;
+			return (load->error = errno), false;
+		}
+		load->length += nread;
+	}
+	return true;
+}
+
+/* Loads the file of 'load' with blocking calls */
+void _devkit_load_sync( _DevkitLoad *load) {
+	int fd = open( load->path, O_RDONLY | O_CLOEXEC);
+	if ( fd < 0) {
+		load->error = errno;
+		return;
+	}
+	struct stat info;
+	if ( fstat( fd, &info) < 0) load->error = errno;
+	else _devkit_load_pread( load, fd, S_ISREG(info.st_mode) ? info.st_size : 0);
+	close( fd);
+}
+
+typedef struct {
+	_DevkitLoad *loads;
+	size_t nloads;
+	atomic_size_t next;
+} _DevkitLoadQueue;
+
+void* _devkit_load_worker( void *arg) {
+	_DevkitLoadQueue *queue = arg;
+	for (size_t idx; (idx = atomic_fetch_add( &queue->next, 1)) < queue->nloads;)
+		_devkit_load_sync( &queue->loads[idx]);
+	return nullptr;
+}
+
+/* Loads the files with a pool of threads */
+void _devkit_load_threads( _DevkitLoad *loads, size_t nloads) {
+	_DevkitLoadQueue queue = { .loads = loads, .nloads = nloads };
+	pthread_t threads[DEVKIT_FILE_THREADS];
+	size_t nthreads = 0;
+	// The calling thread works too
+	while ( nthreads + 1 < DEVKIT_FILE_THREADS && nthreads + 1 < nloads
+			&& pthread_create( &threads[nthreads], nullptr, _devkit_load_worker, &queue) == 0)
+		++nthreads;
+	_devkit_load_worker( &queue);
+	for (size_t idx = 0; idx < nthreads; idx++) pthread_join( threads[idx], nullptr);
+}
+
+
+#ifdef DEVKIT_FILE_URING
+
+/* Submission and completion rings shared with the kernel */
+typedef struct {
+	int fd;
+	unsigned entries;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ring, *cq_ring;
+	size_t sq_size, cq_size, sqes_size;
+	unsigned queued; // Operations not submitted yet
+} _DevkitRing;
+
+void _devkit_ring_destroy( _DevkitRing *ring) {
+	if ( ring->sqes && ring->sqes != MAP_FAILED) munmap( ring->sqes, ring->sqes_size);
+	if ( ring->cq_ring && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+		munmap( ring->cq_ring, ring->cq_size);
+	if ( ring->sq_ring && ring->sq_ring != MAP_FAILED) munmap( ring->sq_ring, ring->sq_size);
+	close( ring->fd);
+}
+
+/* Sets up 'ring', returning false if io_uring or one of its operations used here
+ * is unavailable (old kernels, or blocked in containers) */
+bool _devkit_ring_init( _DevkitRing *ring) {
+	struct io_uring_params params = {0};
+	*ring = (_DevkitRing) { .fd = syscall( __NR_io_uring_setup, DEVKIT_FILE_RING_ENTRIES, &params) };
+	if ( ring->fd < 0) return false;
+	ring->entries = params.sq_entries;
+
+	ring->sq_size = params.sq_off.array + params.sq_entries*sizeof(unsigned);
+	ring->cq_size = params.cq_off.cqes + params.cq_entries*sizeof(struct io_uring_cqe);
+	ring->sqes_size = params.sq_entries*sizeof(struct io_uring_sqe);
+	bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+	if ( single && ring->cq_size > ring->sq_size) ring->sq_size = ring->cq_size;
+
+	ring->sq_ring = mmap( nullptr, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			ring->fd, IORING_OFF_SQ_RING);
+	ring->cq_ring = single ? ring->sq_ring : mmap( nullptr, ring->cq_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+	ring->sqes = mmap( nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			ring->fd, IORING_OFF_SQES);
+	if ( ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+		_devkit_ring_destroy( ring);
+		return false;
+	}
+
+	char *sq = ring->sq_ring, *cq = ring->cq_ring;
+	ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+	ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+	ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	// Ask the kernel if it knows the operations
+	const uint8_t needed[] = { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE };
+	struct io_uring_probe *probe = calloc( 1, sizeof(*probe) + 256*sizeof(struct io_uring_probe_op));
+	bool supported = probe && syscall( __NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, 256) >= 0;
+	for (size_t idx = 0; supported && idx < sizeof(needed); idx++) {
+		supported = needed[idx] <= probe->last_op
+			&& (probe->ops[needed[idx]].flags & IO_URING_OP_SUPPORTED);
+	}
+	free( probe);
+	if (!supported) _devkit_ring_destroy( ring);
+	return supported;
+}
+
+/* Gives a zeroed entry to queue an operation. 'user_data' tells the completion apart.
+ * The kernel sees it at the next submission: there are never more than 'entries' queued */
+struct io_uring_sqe* _devkit_ring_queue( _DevkitRing *ring, uint8_t opcode, int fd, uint64_t user_data) {
+	unsigned tail = *ring->sq_tail, idx = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[idx];
+	memset( sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->user_data = user_data;
+	ring->sq_array[idx] = idx;
+	__atomic_store_n( ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	++ring->queued;
+	return sqe;
+}
+
+/* Submits the queued operations and waits for at least one to complete.
+ * Returns false, with errno set, if the ring stopped working */
+bool _devkit_ring_enter( _DevkitRing *ring) {
+	for (;;) {
+		long submitted = syscall( __NR_io_uring_enter, ring->fd, ring->queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+		if ( submitted >= 0) {
+			ring->queued -= submitted;
+			return true;
+		}
+		if ( errno != EINTR && errno != EAGAIN && errno != EBUSY) return false;
+	}
+}
+
+/* What a completion was for, in the low bits of its 'user_data' (the index of the file is above) */
+enum { _DEVKIT_RING_OPEN, _DEVKIT_RING_STAT, _DEVKIT_RING_READ, _DEVKIT_RING_CLOSE };
+
+/* Reads at most 1 GiB at a time: the length of a read is 32 bits */
+void _devkit_ring_read( _DevkitRing *ring, _DevkitLoad *load, size_t idx) {
+	size_t rest = load->capacity - load->length;
+	struct io_uring_sqe *sqe = _devkit_ring_queue( ring, IORING_OP_READ, load->fd, idx << 2 | _DEVKIT_RING_READ);
+	sqe->addr = (uintptr_t)(load->buffer + load->header + load->length);
+	sqe->len = rest < (1u << 30) ? rest : (1u << 30);
+	sqe->off = load->length;
+	++load->pending;
+}
+
+void _devkit_ring_close( _DevkitRing *ring, _DevkitLoad *load, size_t idx) {
+	load->phase = _DEVKIT_LOAD_CLOSING;
+	if ( load->fd < 0) return;
+	_devkit_ring_queue( ring, IORING_OP_CLOSE, load->fd, idx << 2 | _DEVKIT_RING_CLOSE);
+	++load->pending;
+}
+
+/* Gives up on the loads of 'ring' that are still in it, if it stops working. They fail
+ * with 'error', keeping the descriptors and buffers the kernel may still use */
+void _devkit_ring_abort( _DevkitLoad *loads, size_t nloads, int error) {
+	for (size_t idx = 0; idx < nloads; idx++) {
+		_DevkitLoad *load = &loads[idx];
+		if ( !load->pending) {
+			// Finished, or waiting for the next step which will not come
+			if ( load->phase != _DEVKIT_LOAD_CLOSING) {
+				if ( load->fd >= 0) close( load->fd);
+				if ( !load->error) load->error = error;
+			}
+			continue;
+		}
+		if ( load->phase == _DEVKIT_LOAD_CLOSING) continue; // Only its close is left
+		if ( !load->error) load->error = error;
+		load->buffer = nullptr;
+	}
+}
+
+/* Loads the files through 'ring'. Every file opens and gets its size at once, then
+ * is read into a buffer of that size and closed. If the ring stops working, the
+ * files it did not start are loaded with threads */
+void _devkit_load_ring( _DevkitRing *ring, _DevkitLoad *loads, size_t nloads) {
+	// At most two operations per file are in flight, so the rings never overflow
+	size_t next = 0, active = 0;
+	while ( next < nloads || active) {
+		for (; next < nloads && active < ring->entries / 2; next++, active++) {
+			_DevkitLoad *load = &loads[next];
+			struct io_uring_sqe *sqe = _devkit_ring_queue( ring, IORING_OP_OPENAT, AT_FDCWD, next << 2 | _DEVKIT_RING_OPEN);
+			sqe->addr = (uintptr_t)load->path;
+			sqe->open_flags = O_RDONLY | O_CLOEXEC;
+			sqe = _devkit_ring_queue( ring, IORING_OP_STATX, AT_FDCWD, next << 2 | _DEVKIT_RING_STAT);
+			sqe->addr = (uintptr_t)load->path;
+			sqe->len = STATX_TYPE | STATX_SIZE;
+			sqe->off = (uintptr_t)&load->stat;
+			load->pending = 2;
+		}
+		if ( !_devkit_ring_enter( ring)) {
+			_devkit_ring_abort( loads, next, errno);
+			_devkit_load_threads( loads + next, nloads - next);
+			return;
+		}
+
+		unsigned head = *ring->cq_head, tail = __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++) {
+			struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+			size_t idx = cqe->user_data >> 2;
+			int result = cqe->res;
+			_DevkitLoad *load = &loads[idx];
+			--load->pending;
+
+			switch ( cqe->user_data & 3) {
+				case _DEVKIT_RING_OPEN:
+					if ( result < 0) load->error = -result;
+					else load->fd = result;
+					break;
+				case _DEVKIT_RING_STAT:
+					if ( result < 0) load->error = -result;
+					break;
+				case _DEVKIT_RING_READ:
+					if ( result > 0) load->length += result;
+					else if ( result == 0) load->capacity = load->length; // The file shrank
+					else if ( result != -EINTR && result != -EAGAIN) load->error = -result;
+					break;
+			}
+			if ( load->pending) continue;
+
+			// Every operation of the file completed: move to the next step
+			if ( load->phase == _DEVKIT_LOAD_OPENING) {
+				if ( load->error) {
+					_devkit_ring_close( ring, load, idx);
+				}
+				else if ( !S_ISREG(load->stat.stx_mode) || load->stat.stx_size == 0) {
+					// Size unknown (pipes, /proc...): read it here
+					_devkit_load_pread( load, load->fd, 0);
+					_devkit_ring_close( ring, load, idx);
+				}
+				else {
+					load->capacity = load->stat.stx_size;
+					load->buffer = malloc( load->header + load->capacity + 1);
+					if (!load->buffer) {
+						load->error = ENOMEM;
+						_devkit_ring_close( ring, load, idx);
+					}
+					else {
+						load->phase = _DEVKIT_LOAD_READING;
+						_devkit_ring_read( ring, load, idx);
+					}
+				}
+			}
+			else if ( load->phase == _DEVKIT_LOAD_READING) {
+				if ( load->error || load->length == load->capacity) _devkit_ring_close( ring, load, idx);
+				else _devkit_ring_read( ring, load, idx);
+			}
+			// Closing, or the file never opened
+			if ( load->phase == _DEVKIT_LOAD_CLOSING && !load->pending) --active;
+		}
+		__atomic_store_n( ring->cq_head, head, __ATOMIC_RELEASE);
+	}
+}
+
+#endif
+
+
+/* Loads the files of 'loads' with io_uring if possible, or with threads */
+void _devkit_load( _DevkitLoad *loads, size_t nloads) {
+#ifdef DEVKIT_FILE_URING
+	_DevkitRing ring;
+	if ( nloads > 1 && _devkit_ring_init( &ring)) {
+		_devkit_load_ring( &ring, loads, nloads);
+		_devkit_ring_destroy( &ring);
+		return;
+	}
+#endif
+	_devkit_load_threads( loads, nloads);
+}
+
+/* Prepares the loads of 'paths', with room for a struct of 'header' bytes before the bytes */
+_DevkitLoad* _devkit_loads( size_t nfiles, const char *const paths[], size_t header) {
+	_DevkitLoad *loads = calloc( nfiles ? nfiles : 1, sizeof(_DevkitLoad));
+	assert( loads && "devkit_files_load: could not allocate loads!!!");
+	for (size_t idx = 0; idx < nfiles; idx++) {
+		loads[idx].path = paths[idx];
+		loads[idx].header = header;
+		loads[idx].fd = -1;
+	}
+	return loads;
+}
+
+size_t devkit_files_load( size_t nfiles, const char *const paths[], DevkitString *dest[]) {
+	_DevkitLoad *loads = _devkit_loads( nfiles, paths, sizeof(DevkitString));
+	_devkit_load( loads, nfiles);
+
+	size_t loaded = 0;
+	for (size_t idx = 0; idx < nfiles; idx++) {
+		if ( loads[idx].error) {
+			free( loads[idx].buffer);
+			dest[idx] = nullptr;
+			errno = loads[idx].error;
+			continue;
+		}
+		dest[idx] = _devkit_file_string( loads[idx].buffer, loads[idx].length);
+		++loaded;
+	}
+	free( loads);
+	return loaded;
+}
+
+size_t devkit_files_load_arrays( size_t nfiles, const char *const paths[], DevkitArray *dest[]) {
+	_DevkitLoad *loads = _devkit_loads( nfiles, paths, sizeof(DevkitArray));
+	_devkit_load( loads, nfiles);
+
+	size_t loaded = 0;
+	for (size_t idx = 0; idx < nfiles; idx++) {
+		if ( loads[idx].error) {
+			free( loads[idx].buffer);
+			dest[idx] = nullptr;
+			errno = loads[idx].error;
+			continue;
+		}
+		// Shrink the buffer to the contents, or keep it whole if that fails
+		DevkitArray *array = realloc( loads[idx].buffer, sizeof(DevkitArray) + loads[idx].length);
+		if (!array) array = (DevkitArray*)loads[idx].buffer;
+		*array = (DevkitArray) {
+			.length = loads[idx].length,
+			.typesize = 1,
+			.items = array + 1,
+			.allocator = nullptr,
+			.on_heap = true
+		};
+		dest[idx] = array;
+		++loaded;
+	}
+	free( loads);
+	return loaded;
+}
+
+
+bool devkit_files_list( DevkitList *dest, const char *path) {
+#ifdef DEVKIT_DEBUG
+	assert( dest->typesize == sizeof(char*));
+#endif
+	DIR *dir = opendir( path);
+	if (!dir) return false;
+
+	size_t npath = strlen( path);
+	for (struct dirent *entry; (entry = readdir( dir));) {
+		if ( strcmp( entry->d_name, ".") == 0 || strcmp( entry->d_name, "..") == 0) continue;
+
+		size_t nname = strlen( entry->d_name);
+		char *child = malloc( npath + nname + 2);
+		assert( child && "devkit_files_list: could not allocate path!!!");
+		memcpy( child, path, npath);
+		child[npath] = '/';
+		memcpy( child + npath + 1, entry->d_name, nname + 1);
+
+		// Some file systems do not tell the type
+		unsigned char type = entry->d_type;
+		if ( type == DT_UNKNOWN) {
+			struct stat info;
+			if ( stat( child, &info) == 0) type = S_ISDIR(info.st_mode) ? DT_DIR : S_ISREG(info.st_mode) ? DT_REG : DT_UNKNOWN;
+		}
+		if ( type == DT_REG) {
+			devkit_list_add( dest, &child);
+			continue;
+		}
+		if ( type == DT_DIR) devkit_files_list( dest, child);
+		free( child);
+	}
+	closedir( dir);
+	return true;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef _DEVKIT_INTERN_H
+#define _DEVKIT_INTERN_H
+
+// Needed by the read-write locks when compiling in strict ISO mode
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#if defined(__STDC__) && __STDC__ < 202311L
+#define nullptr NULL
+#include <stdbool.h>
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "devkit.h"
+#include "devkit-arena.h"
+
+
+/*
+ * #######################
+ * # DEVKIT INTERN TABLE #
+ * #######################
+ */
+
+/* An intern table keeps a single copy of every distinct string it is given.
+ * Interning the same characters twice gives the same DevkitString, so interned
+ * strings can be compared by pointer. Strings live in an arena owned by the
+ * table and are freed all together with it */
+
+/* Struct definition */
+
+typedef struct {
+	uint64_t hash;
+	const DevkitString *string; // Null if the slot is empty
+} DevkitInternSlot;
+
+/* Open addressing hash table (linear probing) of the interned strings */
+typedef struct {
+	DevkitInternSlot *slots;
+	size_t length, capacity;
+	DevkitArena arena; // Holds the strings
+	bool threadsafe;
+	pthread_rwlock_t lock;
+} DevkitInternTable;
+
+#ifdef DEVKIT_STRIP_PREFIXES
+typedef DevkitInternTable InternTable;
+
+#define intern devkit_intern
+#define intern_view devkit_intern_view
+#define intern_string devkit_intern_string
+#define intern_find devkit_intern_find
+#define intern_table devkit_intern_table
+#define intern_table_destroy devkit_intern_table_destroy
+#endif
+
+
+/* Creates a table with room for 'capacity' strings. It grows as needed.
+ * If 'threadsafe' is set, the table can be used by many threads at once:
+ * strings that are already interned are found without blocking each other */
+extern DevkitInternTable* devkit_intern_table( size_t capacity, bool threadsafe);
+/* Frees the table and every string interned in it */
+extern void devkit_intern_table_destroy( DevkitInternTable *table);
+
+/* Gives the canonical copy of the C string 'text', adding it if new */
+extern const DevkitString* devkit_intern( DevkitInternTable *table, const char *text);
+/* Gives the canonical copy of the characters of 'view', adding it if new */
+extern const DevkitString* devkit_intern_view( DevkitInternTable *table, DevkitStringView view);
+/* Gives the canonical copy of 's', adding it if new */
+extern const DevkitString* devkit_intern_string( DevkitInternTable *table, const DevkitString *s);
+/* Gives the canonical copy of the characters of 'view', or null if they were never interned */
+extern const DevkitString* devkit_intern_find( DevkitInternTable *table, DevkitStringView view);
+
+/* Hash of 'length' bytes of 'items' (not cryptographic: 8 or 16 bytes at a time,
+ * mixed with 64x64->128 bit multiplications) */
+extern uint64_t devkit_hash_bytes( const void *items, size_t length);
+
+
+
+
+/* IMPLEMENTATION */
+
+#define DEVKIT_INTERN_IMPLEMENTATION
+#ifdef DEVKIT_INTERN_IMPLEMENTATION
+
+/* Multiplies 'a' by 'b' and folds the 128 bit product */
+uint64_t _devkit_hash_mix( uint64_t a, uint64_t b) {
+	__uint128_t product = (__uint128_t)a * b;
+	return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+uint64_t _devkit_hash_read64( const uint8_t *p) {
+	uint64_t value;
+	memcpy( &value, p, sizeof(value));
+	return value;
+}
+
+uint64_t _devkit_hash_read32( const uint8_t *p) {
+	uint32_t value;
+	memcpy( &value, p, sizeof(value));
+	return value;
+}
+
+uint64_t devkit_hash_bytes( const void *items, size_t length) {
+	const uint64_t k0 = 0xa0761d6478bd642full, k1 = 0xe7037ed1a0b428dbull, k2 = 0x8ebc6af09c88c6e3ull;
+	const uint8_t *p = items;
+	uint64_t seed = k0 ^ length, a = 0, b = 0;
+
+	size_t rest = length;
+	for (; rest > 16; rest -= 16, p += 16)
+		seed = _devkit_hash_mix( _devkit_hash_read64(p) ^ k1, _devkit_hash_read64(p + 8) ^ seed);
+
+	// The last bytes are read with overlapping loads, without a loop
+	if ( rest >= 8) {
+		a = _devkit_hash_read64(p);
+		b = _devkit_hash_read64(p + rest - 8);
+	}
+	else if ( rest >= 4) {
+		a = _devkit_hash_read32(p);
+		b = _devkit_hash_read32(p + rest - 4);
+	}
+	else if ( rest > 0) {
+		a = (uint64_t)p[0] << 16 | (uint64_t)p[rest >> 1] << 8 | p[rest - 1];
+	}
+	return _devkit_hash_mix( a ^ k1, b ^ seed) ^ _devkit_hash_mix( seed, length ^ k2);
+}
+
+
+DevkitInternTable* devkit_intern_table( size_t capacity, bool threadsafe) {
+	DevkitInternTable *table = malloc( sizeof(*table));
+	assert( table && "DevkitInternTable: could not allocate table!!!");
+
+	// Capacity is a power of two, so that hashes can be masked
+	size_t pow2 = 16;
+	while ( pow2 * 3 < capacity * 4) pow2 <<= 1;
+
+	*table = (DevkitInternTable) {
+		.slots = calloc( pow2, sizeof(DevkitInternSlot)),
+		.length = 0,
+		.capacity = pow2,
+		.arena = devkit_arena_growable( 64 * 1024, 1024 * 1024),
+		.threadsafe = threadsafe
+	};
+	assert( table->slots && "DevkitInternTable: could not allocate slots!!!");
+	if (threadsafe) pthread_rwlock_init( &table->lock, nullptr);
+	return table;
+}
+
+void devkit_intern_table_destroy( DevkitInternTable *table) {
+	if (!table) return;
+	if ( table->threadsafe) pthread_rwlock_destroy( &table->lock);
+	devkit_arena_destroy( &table->arena);
+	free( table->slots);
+	free( table);
+}
+
+
+/* Gives the slot of the characters of 'view', or the empty slot where they would go */
+DevkitInternSlot* _devkit_intern_probe( DevkitInternTable *table, uint64_t hash, DevkitStringView view) {
+	size_t mask = table->capacity - 1;
+	for (size_t idx = hash & mask;; idx = (idx + 1) & mask) {
+		DevkitInternSlot *slot = &table->slots[idx];
+		if ( !slot->string) return slot;
+		if ( slot->hash == hash && slot->string->length == view.length
+				&& memcmp( devkit_string_items( slot->string), view.items, view.length) == 0)
+			return slot;
+	}
+}
+
+void _devkit_intern_grow( DevkitInternTable *table) {
+	DevkitInternSlot *old = table->slots;
+	size_t old_capacity = table->capacity;
+	table->capacity *= 2;
+	table->slots = calloc( table->capacity, sizeof(DevkitInternSlot));
+	assert( table->slots && "DevkitInternTable: could not grow slots!!!");
+
+	size_t mask = table->capacity - 1;
+	for (size_t idx = 0; idx < old_capacity; idx++) {
+		if ( !old[idx].string) continue;
+		size_t slot = old[idx].hash & mask;
+		while ( table->slots[slot].string) slot = (slot + 1) & mask;
+		table->slots[slot] = old[idx];
+	}
+	free( old);
+}
+
+/* Copies the characters of 'view' into the arena of 'table' */
+const DevkitString* _devkit_intern_copy( DevkitInternTable *table, DevkitStringView view) {
+	bool isinline = view.length <= DEVKIT_STRING_INLINE;
+	DevkitString *s = devkit_arena_alloc_aligned( &table->arena,
+			sizeof(DevkitString) + (isinline ? 0 : view.length + 1), _Alignof(DevkitString));
+	*s = (DevkitString) {
+		.length = view.length,
+		.allocator = devkit_arena_allocator( &table->arena),
+		.on_heap = true
+	};
+	if (!isinline) s->heap_items = (char*)(s + 1);
+	char *items = devkit_string_items(s);
+	memcpy( items, view.items, view.length);
+	items[view.length] = '\0';
+	return s;
+}
+
+const DevkitString* devkit_intern_find( DevkitInternTable *table, DevkitStringView view) {
+	uint64_t hash = devkit_hash_bytes( view.items, view.length);
+	if ( table->threadsafe) pthread_rwlock_rdlock( &table->lock);
+	const DevkitString *found = _devkit_intern_probe( table, hash, view)->string;
+	if ( table->threadsafe) pthread_rwlock_unlock( &table->lock);
+	return found;
+}
+
+const DevkitString* devkit_intern_view( DevkitInternTable *table, DevkitStringView view) {
+	uint64_t hash = devkit_hash_bytes( view.items, view.length);
+
+	if ( table->threadsafe) {
+		// Most strings are already interned: look for them with a shared lock first
+		pthread_rwlock_rdlock( &table->lock);
+		const DevkitString *found = _devkit_intern_probe( table, hash, view)->string;
+		pthread_rwlock_unlock( &table->lock);
+		if (found) return found;
+		pthread_rwlock_wrlock( &table->lock);
+	}
+
+	// Another thread may have added it between the two locks: probe again
+	DevkitInternSlot *slot = _devkit_intern_probe( table, hash, view);
+	if ( !slot->string) {
+		// Keep the load under 3/4
+		if ( (table->length + 1) * 4 > table->capacity * 3) {
+			_devkit_intern_grow( table);
+			slot = _devkit_intern_probe( table, hash, view);
+		}
+		*slot = (DevkitInternSlot) { .hash = hash, .string = _devkit_intern_copy( table, view) };
+		++table->length;
+	}
+	const DevkitString *string = slot->string;
+	if ( table->threadsafe) pthread_rwlock_unlock( &table->lock);
+	return string;
+}
+
+const DevkitString* devkit_intern( DevkitInternTable *table, const char *text) {
+	return devkit_intern_view( table, devkit_string_view_of( text));
+}
+
+const DevkitString* devkit_intern_string( DevkitInternTable *table, const DevkitString *s) {
+	return devkit_intern_view( table, devkit_string_view( s));
+}
+
+#endif
+
+#endif
@@ -0,0 +1,355 @@
+#ifndef _DEVKIT_POOL_H
+#define _DEVKIT_POOL_H
+
+#if defined(__STDC__) && __STDC__ < 202311L
+#define nullptr NULL
+#include <stdbool.h>
+#endif
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "devkit-allocator.h"
+
+
+/*
+ * ###############
+ * # DEVKIT POOL #
+ * ###############
+ */
+
+/* A pool hands out slots of the same size, carved from big slabs.
+ * Unlike an arena, every slot can be freed on its own, in any order:
+ * free slots are kept in a list that lives inside the slots themselves */
+
+/* Struct definition */
+
+/* Header of a slab. The slots follow it */
+typedef struct devkit_pool_slab {
+	struct devkit_pool_slab *next;
+} DevkitPoolSlab;
+
+/* A free slot, linked to the next free one */
+typedef struct devkit_pool_slot {
+	struct devkit_pool_slot *next;
+} DevkitPoolSlot;
+
+#define DEVKIT_POOL_SLAB_HEADER \
+	((sizeof(DevkitPoolSlab) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1))
+
+typedef struct {
+	size_t slot_size;
+	size_t alignment; // Of every slot
+	size_t slots_per_slab;
+	DevkitPoolSlot *free; // Freed slots
+	DevkitPoolSlab *slabs; // First slab
+	DevkitPoolSlab *current; // Slab being carved
+	size_t carved; // Slots carved from 'current'
+	bool threadsafe;
+	atomic_size_t generation; // Changes when the pool is reset, to invalidate thread caches
+	pthread_mutex_t lock;
+	DevkitAllocator allocator; // Set by 'devkit_pool_allocator'
+} DevkitPool;
+
+/* Slots moved at once between a thread cache and its pool */
+#define DEVKIT_POOL_CACHE_BATCH 32
+/* Pools that can be cached at the same time by a thread */
+#define DEVKIT_POOL_CACHES 8
+
+/* Slots kept by a thread for a thread-safe pool */
+typedef struct {
+	DevkitPool *pool;
+	size_t generation;
+	DevkitPoolSlot *free;
+	size_t length;
+} DevkitPoolCache;
+
+#ifdef DEVKIT_STRIP_PREFIXES
+typedef DevkitPool Pool;
+
+#define pool_of devkit_pool_of
+#define pool_alloc devkit_pool_alloc
+#define pool_calloc devkit_pool_calloc
+#define pool_free devkit_pool_free
+#define pool_reset devkit_pool_reset
+#define pool_destroy devkit_pool_destroy
+#endif
+
+
+/* Creates a pool of slots of 'slot_size' bytes aligned to 'alignment' (a power of two, or 0 for
+ * the alignment of a pointer), allocating 'slots_per_slab' slots at a time.
+ * If 'threadsafe' is set, the pool can be shared between threads: each thread keeps a small
+ * cache of slots and only locks the pool to refill or empty it */
+extern DevkitPool* devkit_pool( size_t slot_size, size_t alignment, size_t slots_per_slab, bool threadsafe);
+#define devkit_pool_of( type, slots_per_slab, threadsafe) \
+	devkit_pool( sizeof(type), _Alignof(type), (slots_per_slab), (threadsafe))
+
+/* Gives a slot of 'pool' */
+extern void* devkit_pool_alloc( DevkitPool *pool);
+/* Gives a zeroed slot of 'pool' */
+extern void* devkit_pool_calloc( DevkitPool *pool);
+/* Gives 'ptr' back to 'pool' */
+extern void devkit_pool_free( DevkitPool *pool, void *ptr);
+
+/* Gives every slot back to 'pool' at once, keeping the slabs for reuse.
+ * No other thread must be using the pool meanwhile. The slots other threads
+ * cached before are dropped the next time they use the pool */
+extern void devkit_pool_reset( DevkitPool *pool);
+/* Gives the slots cached by the calling thread back to 'pool'.
+ * Call it before a thread exits, or its cached slots are unusable until a reset */
+extern void devkit_pool_flush( DevkitPool *pool);
+/* Frees every slab of 'pool' and the pool itself */
+extern void devkit_pool_destroy( DevkitPool *pool);
+
+/* Gives an allocator that takes slots from 'pool'.
+ * Allocations cannot be larger than the slot size */
+extern const DevkitAllocator* devkit_pool_allocator( DevkitPool *pool);
+
+
+
+
+/* IMPLEMENTATION */
+
+#define DEVKIT_POOL_IMPLEMENTATION
+#ifdef DEVKIT_POOL_IMPLEMENTATION
+
+DevkitPool* devkit_pool( size_t slot_size, size_t alignment, size_t slots_per_slab, bool threadsafe) {
+#ifdef DEVKIT_DEBUG
+	assert( slot_size > 0 && slots_per_slab > 0);
+	assert( (alignment & (alignment - 1)) == 0);
+#endif
+	DevkitPool *pool = malloc( sizeof(*pool));
+	assert( pool && "DevkitPool: could not allocate pool!!!");
+
+	// Every slot must be able to hold the free list link
+	if ( slot_size < sizeof(DevkitPoolSlot)) slot_size = sizeof(DevkitPoolSlot);
+	// Every slot must be aligned, so the size is a multiple of the alignment
+	if ( alignment < _Alignof(DevkitPoolSlot)) alignment = _Alignof(DevkitPoolSlot);
+	slot_size = (slot_size + alignment - 1) & ~(alignment - 1);
+
+	*pool = (DevkitPool) {
+		.slot_size = slot_size,
+		.alignment = alignment,
+		.slots_per_slab = slots_per_slab,
+		.free = nullptr,
+		.slabs = nullptr,
+		.current = nullptr,
+		.carved = 0,
+		.threadsafe = threadsafe,
+		.generation = 0
+	};
+	if (threadsafe) pthread_mutex_init( &pool->lock, nullptr);
+	return pool;
+}
+
+
+/* Bytes before the first slot of a slab: the header, padded to the alignment of the slots */
+size_t _devkit_pool_header( const DevkitPool *pool) {
+	return pool->alignment > DEVKIT_POOL_SLAB_HEADER ? pool->alignment : DEVKIT_POOL_SLAB_HEADER;
+}
+
+/* Gives a slot from the free list or the slabs, without locking */
+void* _devkit_pool_take( DevkitPool *pool) {
+	if ( pool->free) {
+		DevkitPoolSlot *slot = pool->free;
+		pool->free = slot->next;
+		return slot;
+	}
+
+	// Carve the current slab, moving to the next (or a new) one when it's full
+	if ( !pool->current || pool->carved == pool->slots_per_slab) {
+		DevkitPoolSlab *next = pool->current ? pool->current->next : pool->slabs;
+		if (!next) {
+			size_t size = _devkit_pool_header( pool) + pool->slot_size*pool->slots_per_slab;
+			// 'malloc' only aligns to max_align_t
+			next = pool->alignment > _Alignof(max_align_t)
+				? aligned_alloc( pool->alignment, size) : malloc( size);
+			if (!next) {
+				puts("DevkitPool could not allocate a new slab!");
+				exit(EXIT_FAILURE);
+			}
+			next->next = nullptr;
+			if ( pool->current) pool->current->next = next;
+			else pool->slabs = next;
+		}
+		pool->current = next;
+		pool->carved = 0;
+	}
+	return (char*)pool->current + _devkit_pool_header( pool) + pool->slot_size*pool->carved++;
+}
+
+
+_Thread_local DevkitPoolCache _DEVKIT_POOL_CACHES[DEVKIT_POOL_CACHES] = {0};
+
+/* Gives the cache of the calling thread for 'pool', taking over an unused
+ * (or the first) entry if needed */
+DevkitPoolCache* _devkit_pool_cache( DevkitPool *pool) {
+	// Pairs with the release of 'devkit_pool_reset'
+	size_t generation = atomic_load_explicit( &pool->generation, memory_order_acquire);
+	DevkitPoolCache *victim = &_DEVKIT_POOL_CACHES[0];
+	for (size_t idx = 0; idx < DEVKIT_POOL_CACHES; idx++) {
+		DevkitPoolCache *cache = &_DEVKIT_POOL_CACHES[idx];
+		if ( cache->pool == pool) {
+			if ( cache->generation == generation) return cache;
+			// The pool was reset: cached slots were already given back
+			cache->free = nullptr, cache->length = 0;
+			cache->generation = generation;
+			return cache;
+		}
+		if ( !cache->pool) victim = cache;
+	}
+	if ( victim->pool) devkit_pool_flush( victim->pool);
+	*victim = (DevkitPoolCache) { .pool = pool, .generation = generation };
+	return victim;
+}
+
+
+void* devkit_pool_alloc( DevkitPool *pool) {
+	if ( !pool->threadsafe) return _devkit_pool_take( pool);
+
+	DevkitPoolCache *cache = _devkit_pool_cache( pool);
+	if ( !cache->free) {
+		pthread_mutex_lock( &pool->lock);
+		for (size_t idx = 0; idx < DEVKIT_POOL_CACHE_BATCH; idx++) {
+			DevkitPoolSlot *slot = _devkit_pool_take( pool);
+			slot->next = cache->free;
+			cache->free = slot;
+		}
+		// The slots belong to the generation they were taken in
+		cache->generation = atomic_load_explicit( &pool->generation, memory_order_relaxed);
+		pthread_mutex_unlock( &pool->lock);
+		cache->length = DEVKIT_POOL_CACHE_BATCH;
+	}
+	DevkitPoolSlot *slot = cache->free;
+	cache->free = slot->next;
+	--cache->length;
+	return slot;
+}
+
+
+void* devkit_pool_calloc( DevkitPool *pool) {
+	void *slot = devkit_pool_alloc( pool);
+	memset( slot, 0, pool->slot_size);
+	return slot;
+}
+
+
+void devkit_pool_free( DevkitPool *pool, void *ptr) {
+	if (!ptr) return;
+	DevkitPoolSlot *slot = ptr;
+
+	if ( !pool->threadsafe) {
+		slot->next = pool->free;
+		pool->free = slot;
+		return;
+	}
+
+	DevkitPoolCache *cache = _devkit_pool_cache( pool);
+	slot->next = cache->free;
+	cache->free = slot;
+	// Give a batch back when the cache holds too many slots
+	if ( ++cache->length >= 2*DEVKIT_POOL_CACHE_BATCH) {
+		DevkitPoolSlot *first = cache->free, *last = first;
+		for (size_t idx = 1; idx < DEVKIT_POOL_CACHE_BATCH; idx++) last = last->next;
+		cache->free = last->next;
+		cache->length -= DEVKIT_POOL_CACHE_BATCH;
+
+		pthread_mutex_lock( &pool->lock);
+		// Slots of a generation before a reset are not given back twice
+		if ( cache->generation == atomic_load_explicit( &pool->generation, memory_order_relaxed)) {
+			last->next = pool->free;
+			pool->free = first;
+		}
+		pthread_mutex_unlock( &pool->lock);
+	}
+}
+
+
+void devkit_pool_flush( DevkitPool *pool) {
+	for (size_t idx = 0; idx < DEVKIT_POOL_CACHES; idx++) {
+		DevkitPoolCache *cache = &_DEVKIT_POOL_CACHES[idx];
+		if ( cache->pool != pool) continue;
+
+		if ( cache->free) {
+			DevkitPoolSlot *last = cache->free;
+			while ( last->next) last = last->next;
+			pthread_mutex_lock( &pool->lock);
+			// Slots cached before a reset were already given back
+			if ( cache->generation == atomic_load_explicit( &pool->generation, memory_order_relaxed)) {
+				last->next = pool->free;
+				pool->free = cache->free;
+			}
+			pthread_mutex_unlock( &pool->lock);
+		}
+		*cache = (DevkitPoolCache) {0};
+	}
+}
+
+
+void devkit_pool_reset( DevkitPool *pool) {
+	if ( pool->threadsafe) pthread_mutex_lock( &pool->lock);
+	pool->free = nullptr;
+	pool->current = nullptr;
+	pool->carved = 0;
+	atomic_fetch_add_explicit( &pool->generation, 1, memory_order_release);
+	if ( pool->threadsafe) pthread_mutex_unlock( &pool->lock);
+}
+
+
+void* _devkit_pool_allocate( void *context, size_t size) {
+	DevkitPool *pool = context;
+	(void)size;
+	assert( size <= pool->slot_size && "DevkitPool: allocation larger than a slot!!!");
+	return devkit_pool_alloc( pool);
+}
+
+void* _devkit_pool_reallocate( void *context, void *ptr, size_t old_size, size_t new_size) {
+	DevkitPool *pool = context;
+	(void)old_size;
+	assert( new_size <= pool->slot_size && "DevkitPool: allocation larger than a slot!!!");
+	if ( new_size > pool->slot_size) return nullptr;
+	return ptr ? ptr : devkit_pool_alloc( pool);
+}
+
+void _devkit_pool_deallocate( void *context, void *ptr, size_t size) {
+	(void)size;
+	devkit_pool_free( context, ptr);
+}
+
+const DevkitAllocator* devkit_pool_allocator( DevkitPool *pool) {
+	pool->allocator = (DevkitAllocator) {
+		.allocate = _devkit_pool_allocate,
+		.reallocate = _devkit_pool_reallocate,
+		.deallocate = _devkit_pool_deallocate,
+		.context = pool
+	};
+	return &pool->allocator;
+}
+
+
+void devkit_pool_destroy( DevkitPool *pool) {
+	if (!pool) return;
+
+	if ( pool->threadsafe) {
+		// Forget the cache of the calling thread, the others must be flushed already
+		for (size_t idx = 0; idx < DEVKIT_POOL_CACHES; idx++) {
+			if ( _DEVKIT_POOL_CACHES[idx].pool == pool)
+				_DEVKIT_POOL_CACHES[idx] = (DevkitPoolCache) {0};
+		}
+		pthread_mutex_destroy( &pool->lock);
+	}
+	for (DevkitPoolSlab *slab = pool->slabs, *next; slab; slab = next) {
+		next = slab->next;
+		free( slab);
+	}
+	free( pool);
+}
+
+#endif
+
+#endif
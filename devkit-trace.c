@@ -0,0 +1,229 @@
+/*
+ * Offline analyzer of the allocation traces written by devkit-debugger.h
+ * when compiled with DEVKIT_DEBUGGER_TRACE.
+ *
+ * Build: cc -O2 devkit-trace.c -o devkit-trace
+ * Usage: devkit-trace <trace file> [number of call sites to show]
+ *
+ * Rebuilds, from the recorded events, the peak of live memory, the leaks
+ * and the lifetime of the allocations of every call site.
+ */
+
+#define DEVKIT_DEBUGGER_NO_MACROS
+#include "devkit-debugger.h"
+
+typedef struct {
+	const char *file, *function;
+	int line;
+	size_t allocations, frees, bytes;
+	size_t leaks, leaked_bytes;
+	uint64_t lifetime, max_lifetime; // Of freed allocations, in nanoseconds
+} TraceSite;
+
+typedef struct {
+	DevkitTraceRecord record;
+	size_t order; // Position in the file, to keep the order of equal timestamps
+} TraceEvent;
+
+/* Live allocation, in an open addressing table keyed by pointer */
+typedef struct {
+	uint64_t pointer, size, timestamp;
+	uint32_t site;
+	bool used, removed;
+} TraceLive;
+
+TraceSite *sites = nullptr;
+size_t nsites = 0;
+
+TraceLive *live = nullptr;
+size_t live_capacity = 0, live_length = 0, live_removed = 0;
+
+
+int compare_events( const void *a, const void *b) {
+	const TraceEvent *x = a, *y = b;
+	if ( x->record.timestamp != y->record.timestamp)
+		return x->record.timestamp < y->record.timestamp ? -1 : 1;
+	return x->order < y->order ? -1 : x->order > y->order;
+}
+
+int compare_sites( const void *a, const void *b) {
+	const TraceSite *x = a, *y = b;
+	if ( x->leaked_bytes != y->leaked_bytes) return x->leaked_bytes < y->leaked_bytes ? 1 : -1;
+	return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+
+TraceSite* site_of( uint32_t id) {
+	if ( id >= nsites) {
+		size_t n = id + 1;
+		sites = realloc( sites, n * sizeof(TraceSite));
+		memset( sites + nsites, 0, (n - nsites) * sizeof(TraceSite));
+		nsites = n;
+	}
+	return &sites[id];
+}
+
+
+size_t live_slot( uint64_t pointer) {
+	uint64_t h = pointer;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h & (live_capacity - 1);
+}
+
+void live_insert( TraceLive entry);
+
+void live_grow() {
+	TraceLive *old = live;
+	size_t old_capacity = live_capacity;
+	live_capacity = live_capacity ? live_capacity * 2 : 1024;
+	live = calloc( live_capacity, sizeof(TraceLive));
+	live_length = 0, live_removed = 0;
+	for (size_t idx = 0; idx < old_capacity; idx++) {
+		if ( old[idx].used && !old[idx].removed) live_insert( old[idx]);
+	}
+	free( old);
+}
+
+void live_insert( TraceLive entry) {
+	if ( (live_length + live_removed + 1) * 4 > live_capacity * 3) live_grow();
+	size_t slot = live_slot( entry.pointer);
+	while ( live[slot].used && !live[slot].removed)
+		slot = (slot + 1) & (live_capacity - 1);
+	if ( live[slot].removed) --live_removed;
+	entry.used = true, entry.removed = false;
+	live[slot] = entry;
+	++live_length;
+}
+
+TraceLive* live_find( uint64_t pointer) {
+	if (!live_capacity) return nullptr;
+	size_t slot = live_slot( pointer);
+	while ( live[slot].used) {
+		if ( !live[slot].removed && live[slot].pointer == pointer) return &live[slot];
+		slot = (slot + 1) & (live_capacity - 1);
+	}
+	return nullptr;
+}
+
+
+int main( int argc, char **argv) {
+	if ( argc < 2) {
+		fprintf( stderr, "Usage: %s <trace file> [number of call sites to show]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	size_t top = argc > 2 ? strtoul( argv[2], nullptr, 10) : 20;
+
+	FILE *file = fopen( argv[1], "rb");
+	if (!file) {
+		perror( argv[1]);
+		return EXIT_FAILURE;
+	}
+	fseek( file, 0, SEEK_END);
+	long length = ftell( file);
+	rewind( file);
+	char *data = malloc( length);
+	if ( fread( data, 1, length, file) != (size_t)length
+			|| length < (long)sizeof(DEVKIT_TRACE_MAGIC) - 1
+			|| memcmp( data, DEVKIT_TRACE_MAGIC, sizeof(DEVKIT_TRACE_MAGIC) - 1) != 0) {
+		fprintf( stderr, "%s: not a devkit trace\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	fclose( file);
+
+	// Split call site definitions from events
+	DevkitTraceRecord *records = (DevkitTraceRecord*)(data + sizeof(DEVKIT_TRACE_MAGIC) - 1);
+	size_t nrecords = (length - (sizeof(DEVKIT_TRACE_MAGIC) - 1)) / sizeof(DevkitTraceRecord);
+	TraceEvent *events = malloc( nrecords * sizeof(TraceEvent));
+	size_t nevents = 0;
+
+	for (size_t idx = 0; idx < nrecords; idx++) {
+		DevkitTraceRecord *record = &records[idx];
+		if ( record->op != DEVKIT_TRACE_SITE) {
+			events[nevents] = (TraceEvent) { .record = *record, .order = nevents };
+			++nevents;
+			continue;
+		}
+		size_t payload = (record->size + sizeof(DevkitTraceRecord) - 1) / sizeof(DevkitTraceRecord);
+		if ( idx + payload >= nrecords) break;
+		TraceSite *site = site_of( record->site);
+		if ( !site->file) {
+			const char *names = (const char*)(record + 1);
+			site->file = names;
+			site->function = names + strlen( names) + 1;
+			site->line = (int)record->pointer;
+		}
+		idx += payload;
+	}
+	qsort( events, nevents, sizeof(TraceEvent), compare_events);
+
+	// Replay the events
+	size_t live_bytes = 0, peak_bytes = 0, allocations = 0, frees = 0, unknown_frees = 0;
+	uint64_t peak_time = 0;
+	uint64_t start = nevents ? events[0].record.timestamp : 0;
+	uint64_t end = nevents ? events[nevents - 1].record.timestamp : 0;
+
+	for (size_t idx = 0; idx < nevents; idx++) {
+		DevkitTraceRecord *record = &events[idx].record;
+		if ( record->op == DEVKIT_TRACE_FREE) {
+			TraceLive *entry = live_find( record->pointer);
+			if (!entry) {
+				++unknown_frees;
+				continue;
+			}
+			TraceSite *site = site_of( entry->site);
+			uint64_t lifetime = record->timestamp - entry->timestamp;
+			++site->frees;
+			site->lifetime += lifetime;
+			if ( lifetime > site->max_lifetime) site->max_lifetime = lifetime;
+			live_bytes -= entry->size;
+			entry->removed = true;
+			--live_length, ++live_removed;
+			++frees;
+		}
+		else {
+			TraceSite *site = site_of( record->site);
+			++site->allocations;
+			site->bytes += record->size;
+			live_insert( (TraceLive) {
+				.pointer = record->pointer,
+				.size = record->size,
+				.timestamp = record->timestamp,
+				.site = record->site
+			});
+			live_bytes += record->size;
+			if ( live_bytes > peak_bytes) peak_bytes = live_bytes, peak_time = record->timestamp;
+			++allocations;
+		}
+	}
+
+	// What is still live was leaked
+	for (size_t idx = 0; idx < live_capacity; idx++) {
+		if ( !live[idx].used || live[idx].removed) continue;
+		TraceSite *site = site_of( live[idx].site);
+		++site->leaks;
+		site->leaked_bytes += live[idx].size;
+	}
+
+	printf("Events: %zu allocations, %zu frees (%zu of unknown pointers) in %.3f ms\n",
+			allocations, frees, unknown_frees, (end - start) / 1e6);
+	printf("Peak live memory: %zu bytes at %.3f ms\n", peak_bytes, (peak_time - start) / 1e6);
+	printf("Leaked: %zu bytes in %zu allocations\n\n", live_bytes, live_length);
+
+	qsort( sites, nsites, sizeof(TraceSite), compare_sites);
+	printf("%-40s %10s %12s %8s %12s %12s %12s\n", "Call site", "allocs", "bytes",
+			"leaks", "leaked", "avg life us", "max life us");
+	for (size_t idx = 0; idx < nsites && idx < top; idx++) {
+		TraceSite *site = &sites[idx];
+		if ( !site->allocations) continue;
+		char name[512];
+		snprintf( name, sizeof(name), "%s:%d (%s)", site->file ? site->file : "?",
+				site->line, site->function ? site->function : "?");
+		printf("%-40s %10zu %12zu %8zu %12zu %12.1f %12.1f\n", name, site->allocations,
+				site->bytes, site->leaks, site->leaked_bytes,
+				site->frees ? site->lifetime / 1e3 / site->frees : 0.0,
+				site->max_lifetime / 1e3);
+	}
+	return 0;
+}
@@ -1,5 +1,10 @@
 #ifndef _DEVKIT_H
 #define _DEVKIT_H
+
+// Needed by the POSIX extensions used across devkit headers when compiling in strict ISO mode
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
 #define DEVKIT_IMPLEMENTATION
 
 /* 
@@ -27,6 +32,7 @@
 		size_t length;
 		size_t typesize;
 		size_t counter; <- ignore this (nothing changes if you touch it, so do not)
+		bool readonly; <- set it if items must not be written back by 'foreach'
 	} DevkitIterable;
 */
 
@@ -72,6 +78,22 @@
 #include <assert.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <float.h>
+#include <limits.h>
+#include <locale.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DEVKIT_STRING_SIMD
+#endif
+
+#include "devkit-allocator.h"
+
+#ifdef DEVKIT_LIST_STATS
+#include <stdatomic.h>
+#endif
 
 #ifdef DEVKIT_IMPLEMENTATION
 
@@ -81,6 +103,7 @@
 #define DEVKIT_STRING_IMPLEMENTATION
 
 #define DEVKIT_POINTERS_IMPLEMENTATION
+#define DEVKIT_NUMBERS_IMPLEMENTATION
 
 #endif
 
@@ -129,6 +152,7 @@ typedef struct devkit_iterable {
 	size_t length;
 	size_t typesize;
 	size_t counter;
+	bool readonly; // Items are not written back at each iteration
 } DevkitIterable;
 
 
@@ -138,12 +162,24 @@ typedef struct devkit_iterable {
  * ##########
  */
 
+/* Strings of up to DEVKIT_STRING_INLINE characters are stored inside the struct,
+ * longer ones in their own buffer: use 'devkit_string_items' to reach them.
+ * Characters are always followed by a null terminator */
+
+#define DEVKIT_STRING_INLINE 23
+
 typedef struct {
-	char *items;
+	union {
+		char *heap_items; // Longer strings only: read them through devkit_string_items
+		char inline_items[DEVKIT_STRING_INLINE + 1];
+	};
 	size_t length;
+	const DevkitAllocator *allocator; // Null for the standard library
 	bool on_heap;
 } DevkitString;
 
+#define devkit_string_isinline( s) ((s)->length <= DEVKIT_STRING_INLINE)
+
 #define DEVKIT_STRING_SIZE(length) (sizeof(DevkitString) + sizeof(double)*(length))
 
 #ifdef DEVKIT_STRIP_PREFIXES
@@ -154,20 +190,182 @@ typedef struct {
 #define string_reverse devkit_string_reverse
 #define string devkit_string
 #define string_stack devkit_string_stack
+#define string_stack_with devkit_string_stack_with
+#define string_with devkit_string_with
+#define string_in devkit_string_in
+#define string_items devkit_string_items
+#define string_isinline devkit_string_isinline
+
+#define string_builder devkit_string_builder
+#define string_builder_with devkit_string_builder_with
+#define string_builder_in devkit_string_builder_in
+#define string_builder_reserve devkit_string_builder_reserve
+#define string_builder_append devkit_string_builder_append
+#define string_builder_nappend devkit_string_builder_nappend
+#define string_builder_append_char devkit_string_builder_append_char
+#define string_builder_append_string devkit_string_builder_append_string
+#define string_builder_append_int devkit_string_builder_append_int
+#define string_builder_append_double devkit_string_builder_append_double
+#define string_builder_appendf devkit_string_builder_appendf
+#define string_builder_finish devkit_string_builder_finish
+#define string_builder_clear devkit_string_builder_clear
+#define string_builder_free devkit_string_builder_free
+
+#define string_find devkit_string_find
+#define string_find_char devkit_string_find_char
+#define string_count devkit_string_count
+#define string_count_char devkit_string_count_char
+#define string_equals devkit_string_equals
+#define string_compare devkit_string_compare
+#define string_split devkit_string_split
+#define string_split_next devkit_string_split_next
+
+#define string_view devkit_string_view
+#define string_view_of devkit_string_view_of
+#define string_view_slice devkit_string_view_slice
+#define string_view_trim devkit_string_view_trim
+#define string_view_split devkit_string_view_split
+#define string_view_find devkit_string_view_find
+#define string_view_find_char devkit_string_view_find_char
+#define string_view_equals devkit_string_view_equals
+#define string_view_materialize devkit_string_view_materialize
+#define string_view_materialize_with devkit_string_view_materialize_with
 
 #endif
 
 /* Declarations */
 
 extern DevkitString* devkit_string( const char *text);
+/* Same as 'devkit_string', memory comes from 'allocator' */
+extern DevkitString* devkit_string_with( const DevkitAllocator *allocator, const char *text);
+/* Same as 'devkit_string', memory comes from DevkitArena 'arena' (needs devkit-arena.h) */
+#define devkit_string_in( arena, text) devkit_string_with( devkit_arena_allocator(arena), (text))
+/* Creates a string whose struct is on the stack. Short strings need no allocation */
 extern DevkitString devkit_string_stack( const char *text);
+/* Same as 'devkit_string_stack', long strings take their characters from 'allocator' */
+extern DevkitString devkit_string_stack_with( const DevkitAllocator *allocator, const char *text);
+/* Gives the characters of 's', wherever they are stored */
+extern char* devkit_string_items( const DevkitString *s);
 extern char* devkit_string_slice( const DevkitString *restrict s, size_t start, size_t end);
 extern void devkit_string_reverse( DevkitString *s);
+
+/* Characters of another string, or of any buffer, that are not owned:
+ * views need no allocation and are valid as long as what they point to */
+typedef struct {
+	const char *items;
+	size_t length;
+} DevkitStringView;
+
+#ifdef DEVKIT_STRIP_PREFIXES
+typedef DevkitStringView StringView;
+#endif
+
+/* Gives a view of the whole of 's' */
+extern DevkitStringView devkit_string_view( const DevkitString *s);
+/* Gives a view of the C string 'text' */
+extern DevkitStringView devkit_string_view_of( const char *text);
+/* Gives a view of the characters of 'view' from 'start' to 'end' (excluded) */
+extern DevkitStringView devkit_string_view_slice( DevkitStringView view, size_t start, size_t end);
+/* Gives 'view' without the whitespace at its ends */
+extern DevkitStringView devkit_string_view_trim( DevkitStringView view);
+/* Copies 'view' into a new string, to free with 'devkit_string_free' */
+extern DevkitString devkit_string_view_materialize( DevkitStringView view);
+/* Same as 'devkit_string_view_materialize', memory comes from 'allocator' */
+extern DevkitString devkit_string_view_materialize_with( const DevkitAllocator *allocator, DevkitStringView view);
+
+extern DevkitIterable devkit_string_view_asiterable( DevkitStringView *);
+
+/* Searching. The functions below use SSE2 or AVX2, whichever the CPU supports */
+
+#define DEVKIT_STRING_NOT_FOUND ((size_t)-1)
+
+/* Gives the index of the first 'c' in 's' from 'start', or DEVKIT_STRING_NOT_FOUND */
+extern size_t devkit_string_find_char( const DevkitString *s, char c, size_t start);
+/* Gives the index of the first 'needle' in 's' from 'start', or DEVKIT_STRING_NOT_FOUND */
+extern size_t devkit_string_find( const DevkitString *s, const char *needle, size_t start);
+/* Counts the 'c' in 's' */
+extern size_t devkit_string_count_char( const DevkitString *s, char c);
+/* Counts the occurrences of 'needle' in 's' that do not overlap */
+extern size_t devkit_string_count( const DevkitString *s, const char *needle);
+extern bool devkit_string_equals( const DevkitString *a, const DevkitString *b);
+/* Compares 'a' and 'b' like 'strcmp' */
+extern int devkit_string_compare( const DevkitString *a, const DevkitString *b);
+
+/* Same as the functions above, on views */
+extern size_t devkit_string_view_find_char( DevkitStringView view, char c, size_t start);
+extern size_t devkit_string_view_find( DevkitStringView view, const char *needle, size_t start);
+extern bool devkit_string_view_equals( DevkitStringView a, DevkitStringView b);
+
+/* Iterator over the tokens of a string between a delimiter */
+typedef struct {
+	const char *items;
+	size_t length;
+	size_t position; // Start of the next token
+	char delimiter;
+} DevkitStringSplit;
+
+#ifdef DEVKIT_STRIP_PREFIXES
+typedef DevkitStringSplit StringSplit;
+#endif
+
+/* Splits 's' at every 'delimiter'. 's' must outlive the iterator */
+extern DevkitStringSplit devkit_string_split( const DevkitString *s, char delimiter);
+extern DevkitStringSplit devkit_string_view_split( DevkitStringView view, char delimiter);
+/* Gives a view of the next token in 'token' (empty tokens included).
+ * Returns false when there are no more tokens */
+extern bool devkit_string_split_next( DevkitStringSplit *split, DevkitStringView *token);
 extern void devkit_string_free( DevkitString *s);
 
 extern DevkitIterable devkit_string_asiterable( DevkitString *);
 
 
+/* String builder: a growing buffer of characters, always null terminated.
+ * Its capacity doubles when full, so appending is amortized constant time */
+
+typedef struct {
+	char *items;
+	size_t length;
+	size_t capacity; // Null terminator included
+	const DevkitAllocator *allocator; // Null for the standard library
+} DevkitStringBuilder;
+
+#ifdef DEVKIT_STRIP_PREFIXES
+typedef DevkitStringBuilder StringBuilder;
+#endif
+
+/* Creates an empty builder with room for 'capacity' characters */
+extern DevkitStringBuilder devkit_string_builder( size_t capacity);
+/* Same as 'devkit_string_builder', memory comes from 'allocator' */
+extern DevkitStringBuilder devkit_string_builder_with( const DevkitAllocator *allocator, size_t capacity);
+/* Same as 'devkit_string_builder', memory comes from DevkitArena 'arena' (needs devkit-arena.h) */
+#define devkit_string_builder_in( arena, capacity) \
+	devkit_string_builder_with( devkit_arena_allocator(arena), (capacity))
+
+/* Makes room for 'nchars' more characters */
+extern void devkit_string_builder_reserve( DevkitStringBuilder *builder, size_t nchars);
+
+/* Appends the C string 'text' */
+extern void devkit_string_builder_append( DevkitStringBuilder *builder, const char *text);
+/* Appends the first 'nchars' characters of 'text' */
+extern void devkit_string_builder_nappend( DevkitStringBuilder *builder, const char *text, size_t nchars);
+extern void devkit_string_builder_append_char( DevkitStringBuilder *builder, char c);
+extern void devkit_string_builder_append_string( DevkitStringBuilder *builder, const DevkitString *s);
+extern void devkit_string_builder_append_int( DevkitStringBuilder *builder, long long value);
+/* Appends 'value' with the fewest digits that read back as the same double */
+extern void devkit_string_builder_append_double( DevkitStringBuilder *builder, double value);
+/* Appends like 'printf', formatting straight into the builder */
+extern void devkit_string_builder_appendf( DevkitStringBuilder *builder, const char *format, ...)
+	__attribute__((format(printf, 2, 3)));
+
+/* Gives the content of 'builder' as a string, leaving the builder empty.
+ * Long strings take over the buffer of the builder instead of copying it.
+ * Free the string with 'devkit_string_free' */
+extern DevkitString devkit_string_builder_finish( DevkitStringBuilder *builder);
+/* Empties 'builder', keeping its capacity */
+extern void devkit_string_builder_clear( DevkitStringBuilder *builder);
+extern void devkit_string_builder_free( DevkitStringBuilder *builder);
+
+
 
 /*
  * ########
@@ -177,12 +375,29 @@ extern DevkitIterable devkit_string_asiterable( DevkitString *);
 
 /* An approach to variable length arrays in C. */
 
+/* Define DEVKIT_LIST_STATS before including this header to count, in every
+ * list and for all of them, how much memory lists move (see 'devkit_list_stats') */
+
+/* Growth and copies of a list. Without DEVKIT_LIST_STATS, only
+ * 'peak_capacity' (the current capacity) and 'wasted' are given */
+typedef struct {
+	size_t expansions; // Reallocations to a bigger capacity
+	size_t trims;
+	size_t copied; // Bytes copied or moved by expansions, trims, insertions and removals
+	size_t peak_capacity; // Highest capacity, in bytes
+	size_t wasted; // Bytes of capacity not used by items
+} DevkitListStats;
+
 typedef struct {
 	union { size_t length, size; };
 	size_t capacity;
 	size_t typesize;
 	void *items;
+	const DevkitAllocator *allocator; // Null for the standard library
 	bool on_heap;
+#ifdef DEVKIT_LIST_STATS
+	DevkitListStats stats;
+#endif
 } DevkitList;
 
 DevkitIterable devkit_list_asiterable( DevkitList *);
@@ -195,6 +410,9 @@ DevkitIterable devkit_list_asiterable( DevkitList *);
 
 #define list	devkit_list
 #define list_stack	devkit_list_stack
+#define list_stack_with	devkit_list_stack_with
+#define list_with	devkit_list_with
+#define list_in	devkit_list_in
 
 #define list_contains	devkit_list_contains
 #define list_itemat	devkit_itemat
@@ -211,6 +429,9 @@ DevkitIterable devkit_list_asiterable( DevkitList *);
 #define list_expand	devkit_list_expand
 #define list_trim	devkit_list_trim
 #define list_free	devkit_list_free
+#define list_stats	devkit_list_stats
+#define list_global_stats	devkit_list_global_stats
+#define list_stats_print	devkit_list_stats_print
 
 #endif
 
@@ -219,9 +440,19 @@ DevkitIterable devkit_list_asiterable( DevkitList *);
 extern DevkitList* _devkit_list( const size_t typesize, const size_t capacity);
 #define devkit_list( type, capacity) _devkit_list( sizeof(type), (capacity))
 
+/* Same as 'devkit_list', memory comes from 'allocator' */
+extern DevkitList* _devkit_list_with( const DevkitAllocator *allocator, const size_t typesize, const size_t capacity);
+#define devkit_list_with( allocator, type, capacity) _devkit_list_with( (allocator), sizeof(type), (capacity))
+/* Same as 'devkit_list', memory comes from DevkitArena 'arena' (needs devkit-arena.h) */
+#define devkit_list_in( arena, type, capacity) \
+	_devkit_list_with( devkit_arena_allocator(arena), sizeof(type), (capacity))
+
 /* Creates a new list whose struct is on the stack (not the items) */
 extern DevkitList _devkit_list_stack( const size_t typesize, const size_t capacity);
 #define devkit_list_stack( type, capacity) _devkit_list_stack( sizeof(type), (capacity))
+/* Same as 'devkit_list_stack', the items come from 'allocator' */
+extern DevkitList _devkit_list_stack_with( const DevkitAllocator *allocator, const size_t typesize, const size_t capacity);
+#define devkit_list_stack_with( allocator, type, capacity) _devkit_list_stack_with( (allocator), sizeof(type), (capacity))
 
 
 /* Deallocates the items from memory and sets all list values to 0 */
@@ -273,6 +504,15 @@ extern void devkit_list_expand( DevkitList *list, size_t new_capacity);
 /* Reduce list capacity to its length to free unneeded memory */
 extern void devkit_list_trim( DevkitList *list);
 
+/* Gives the growth and copies of 'list' */
+extern DevkitListStats devkit_list_stats( const DevkitList *list);
+/* Gives the growth and copies of every list since the program started.
+ * 'peak_capacity' is the one of the biggest list and 'wasted' the unused
+ * capacity of the lists when they were freed. Needs DEVKIT_LIST_STATS */
+extern DevkitListStats devkit_list_global_stats();
+/* Prints 'stats' with a 'name' to recognize them */
+extern void devkit_list_stats_print( const char *name, const DevkitListStats *stats);
+
 
 /*
  * #########
@@ -284,6 +524,7 @@ typedef struct {
 	union { size_t length, size; };
 	size_t typesize;
 	void* items;
+	const DevkitAllocator *allocator; // Null for the standard library
 	bool on_heap;
 } DevkitArray;
 
@@ -297,6 +538,9 @@ extern DevkitIterable devkit_array_asiterable( DevkitArray *);
 
 #define array	devkit_array
 #define array_stack	devkit_array_stack
+#define array_stack_with	devkit_array_stack_with
+#define array_with	devkit_array_with
+#define array_in	devkit_array_in
 
 #define array_itemat	devkit_array_itemat
 #define array_copyto	devkit_array_copyto
@@ -312,9 +556,19 @@ extern DevkitIterable devkit_array_asiterable( DevkitArray *);
 extern DevkitArray* _devkit_array( size_t typesize, size_t length);
 #define devkit_array( type, length) _devkit_array( sizeof(type), (length))
 
+/* Same as 'devkit_array', memory comes from 'allocator' */
+extern DevkitArray* _devkit_array_with( const DevkitAllocator *allocator, size_t typesize, size_t length);
+#define devkit_array_with( allocator, type, length) _devkit_array_with( (allocator), sizeof(type), (length))
+/* Same as 'devkit_array', memory comes from DevkitArena 'arena' (needs devkit-arena.h) */
+#define devkit_array_in( arena, type, length) \
+	_devkit_array_with( devkit_arena_allocator(arena), sizeof(type), (length))
+
 /* Allocates a new DevkitArray on the stack (with items in heap) */
 extern DevkitArray _devkit_array_stack( size_t typesize, size_t length);
 #define devkit_array_stack( type, length) _devkit_array_stack( sizeof(type), (length))
+/* Same as 'devkit_array_stack', the items come from 'allocator' */
+extern DevkitArray _devkit_array_stack_with( const DevkitAllocator *allocator, size_t typesize, size_t length);
+#define devkit_array_stack_with( allocator, type, length) _devkit_array_stack_with( (allocator), sizeof(type), (length))
 
 
 /* Gets a reference to the item at 'index' in 'array' */
@@ -379,6 +633,7 @@ extern void devkit_array_free( DevkitArray *array);
 typedef struct DevkitVector {
 	double *items;
 	size_t length;
+	const DevkitAllocator *allocator; // Null for the standard library
 	bool on_heap;
 } DevkitVector;
 
@@ -390,6 +645,7 @@ typedef struct DevkitVector {
 typedef struct DevkitMatrix {
 	double *items;
 	size_t length;
+	const DevkitAllocator *allocator; // Null for the standard library
 	size_t columns, rows;
 	bool on_heap;
 } DevkitMatrix;
@@ -409,6 +665,9 @@ extern DevkitIterable devkit_matrix_asiterable( DevkitMatrix *);
 
 #define vector	devkit_vector
 #define vector_stack	devkit_vector_stack
+#define vector_stack_with	devkit_vector_stack_with
+#define vector_with	devkit_vector_with
+#define vector_in	devkit_vector_in
 #define vector_free	devkit_vector_free
 #define vector_copyto	devkit_vector_copyto
 #define vector_sum	devkit_vector_sum
@@ -421,6 +680,9 @@ extern DevkitIterable devkit_matrix_asiterable( DevkitMatrix *);
 
 #define matrix	devkit_matrix
 #define matrix_stack	devkit_matrix_stack
+#define matrix_stack_with	devkit_matrix_stack_with
+#define matrix_with	devkit_matrix_with
+#define matrix_in	devkit_matrix_in
 #define matrix_free	devkit_matrix_free
 #define matrix_copyto	devkit_matrix_copyto
 #define matrix_get	devkit_matrix_get
@@ -436,6 +698,12 @@ extern DevkitIterable devkit_matrix_asiterable( DevkitMatrix *);
 
 extern DevkitVector* devkit_vector( size_t length);
 extern DevkitVector devkit_vector_stack( size_t length);
+/* Same as 'devkit_vector_stack', the items come from 'allocator' */
+extern DevkitVector devkit_vector_stack_with( const DevkitAllocator *allocator, size_t length);
+/* Same as 'devkit_vector', memory comes from 'allocator' */
+extern DevkitVector* devkit_vector_with( const DevkitAllocator *allocator, size_t length);
+/* Same as 'devkit_vector', memory comes from DevkitArena 'arena' (needs devkit-arena.h) */
+#define devkit_vector_in( arena, length) devkit_vector_with( devkit_arena_allocator(arena), (length))
 
 extern void devkit_vector_of( DevkitVector *vec, double values[]);
 extern void devkit_vector_free( DevkitVector *);
@@ -452,6 +720,13 @@ extern bool devkit_vector_iszero( DevkitVector *vec);
 
 extern DevkitMatrix* devkit_matrix( size_t columns, size_t rows);
 extern DevkitMatrix devkit_matrix_stack( size_t columns, size_t rows);
+/* Same as 'devkit_matrix_stack', the items come from 'allocator' */
+extern DevkitMatrix devkit_matrix_stack_with( const DevkitAllocator *allocator, size_t columns, size_t rows);
+/* Same as 'devkit_matrix', memory comes from 'allocator' */
+extern DevkitMatrix* devkit_matrix_with( const DevkitAllocator *allocator, size_t columns, size_t rows);
+/* Same as 'devkit_matrix', memory comes from DevkitArena 'arena' (needs devkit-arena.h) */
+#define devkit_matrix_in( arena, columns, rows) \
+	devkit_matrix_with( devkit_arena_allocator(arena), (columns), (rows))
 
 extern void devkit_matrix_of( DevkitMatrix *mat, double[]);
 extern void devkit_matrix_free( DevkitMatrix *);
@@ -469,6 +744,73 @@ extern bool devkit_matrix_iszero( const DevkitMatrix *mat);
 
 
 
+/*
+ * ###########
+ * # NUMBERS #
+ * ###########
+ */
+
+/* Conversions between text and numbers. Unlike 'strtod' and 'printf' they do not
+ * depend on the locale ('.' is always the decimal point) and never read past the
+ * length of a view, so the text needs no null terminator */
+
+/* Characters needed by 'devkit_format_double' and 'devkit_format_int', null terminator included */
+#define DEVKIT_NUMBER_CHARS 32
+
+#ifdef DEVKIT_STRIP_PREFIXES
+
+#define NUMBER_CHARS DEVKIT_NUMBER_CHARS
+
+#define parse_int	devkit_parse_int
+#define parse_uint	devkit_parse_uint
+#define parse_double	devkit_parse_double
+#define parse_doubles	devkit_parse_doubles
+#define parse_doubles_list	devkit_parse_doubles_list
+#define parse_ints_list	devkit_parse_ints_list
+#define format_int	devkit_format_int
+#define format_double	devkit_format_double
+#define string_to_int	devkit_string_to_int
+#define string_to_double	devkit_string_to_double
+
+#endif
+
+
+/* The parsers read a number at the start of 'view' into 'dest' and return the
+ * characters it takes, or 0 if 'view' does not start with a number (or it overflows).
+ * Leading whitespace is not skipped */
+
+/* Reads an optional sign followed by decimal digits */
+extern size_t devkit_parse_int( DevkitStringView view, long long *dest);
+extern size_t devkit_parse_uint( DevkitStringView view, unsigned long long *dest);
+/* Reads a decimal number with an optional fraction and exponent, "inf", "infinity" or "nan",
+ * correctly rounded to the nearest double */
+extern size_t devkit_parse_double( DevkitStringView view, double *dest);
+
+/* Same as the functions above, but the whole string must be the number. Returns true if it is */
+extern bool devkit_string_to_int( const DevkitString *s, long long *dest);
+extern bool devkit_string_to_double( const DevkitString *s, double *dest);
+
+/* Batch parsers: read the numbers of 'text', separated by whitespace, ',' or ';',
+ * until the end of 'text' or something that is not a number.
+ * Return how many numbers were read */
+
+/* Fills 'dest' from its start, stopping when it is full */
+extern size_t devkit_parse_doubles( DevkitVector *dest, DevkitStringView text);
+/* Adds the numbers to 'dest', a list of double */
+extern size_t devkit_parse_doubles_list( DevkitList *dest, DevkitStringView text);
+/* Adds the numbers to 'dest', a list of long long */
+extern size_t devkit_parse_ints_list( DevkitList *dest, DevkitStringView text);
+
+/* The formatters write a number, null terminated, into 'dest' (at least DEVKIT_NUMBER_CHARS
+ * characters) and return its length */
+
+extern size_t devkit_format_int( char *dest, long long value);
+/* Writes the fewest digits that read back as the same double */
+extern size_t devkit_format_double( char *dest, double value);
+
+
+
+
 /* 
  * ###################################################################
  * # Loop pool implementation needed for nested 'enhanced for' loops #
@@ -543,7 +885,8 @@ extern inline DevkitIterable devkit_dummy_asiterable(DevkitIterable *iter) {
 		DevkitVector: devkit_vector_asiterable, \
 		DevkitMatrix: devkit_matrix_asiterable, \
 		DevkitIterable: devkit_dummy_asiterable, \
-		DevkitString: devkit_string_asiterable \
+		DevkitString: devkit_string_asiterable, \
+		DevkitStringView: devkit_string_view_asiterable \
 		)( &(structure))
 
 
@@ -563,7 +906,8 @@ extern inline DevkitIterable devkit_dummy_asiterable(DevkitIterable *iter) {
 	for (_devkit_loop_current->counter = (start>=0) ? start : 0; _devkit_loop_current->counter < _devkit_loop_current->length; _devkit_loop_current->counter++) { \
 		var = ((type*) _devkit_loop_current->items)[_devkit_loop_current->counter]; \
 		__VA_ARGS__; \
-		memcpy( ((type*) _devkit_loop_current->items)+_devkit_loop_current->counter, &var, _devkit_loop_current->typesize); \
+		if ( !_devkit_loop_current->readonly) \
+			memcpy( ((type*) _devkit_loop_current->items)+_devkit_loop_current->counter, &var, _devkit_loop_current->typesize); \
 	} \
 	_devkit_loop_close; \
 }
@@ -594,30 +938,49 @@ typedef DevkitMatrix Matrix;
 DevkitIterable devkit_string_asiterable( DevkitString *s) {
 	return (DevkitIterable) {
 		.typesize=1,
-		.items=s->items,
+		.items=devkit_string_items(s),
 		.length=s->length,
 	};
 }
 
+char* devkit_string_items( const DevkitString *s) {
+	return devkit_string_isinline(s) ? (char*)s->inline_items : s->heap_items;
+}
+
 DevkitString* devkit_string( const char *text) {
+	return devkit_string_with( nullptr, text);
+}
+
+DevkitString* devkit_string_with( const DevkitAllocator *allocator, const char *text) {
 	size_t length = strlen(text);
-	DevkitString *this = malloc( sizeof(*this) + length);
+	// Long strings keep their characters right after the struct
+	bool isinline = length <= DEVKIT_STRING_INLINE;
+	DevkitString *this = devkit_allocator_alloc( allocator, sizeof(*this) + (isinline ? 0 : length + 1));
 	this->length = length;
+	this->allocator = allocator;
 	this->on_heap = true;
-	this->items = (char*)(this + 1);
-	memcpy( this->items, text, length);
+	if (!isinline) this->heap_items = (char*)(this + 1);
+	memcpy( devkit_string_items(this), text, length + 1);
 	return this;
 }
 
 DevkitString devkit_string_stack( const char *text) {
+	return devkit_string_stack_with( nullptr, text);
+}
+
+DevkitString devkit_string_stack_with( const DevkitAllocator *allocator, const char *text) {
 	size_t length = strlen(text);
-	char *items = malloc( length);
-	memcpy( items, text, length);
-	return (DevkitString) {
+	DevkitString this = {
 		.length = length,
-		.items = items,
+		.allocator = allocator,
 		.on_heap = false
 	};
+	if ( !devkit_string_isinline( &this)) {
+		this.heap_items = devkit_allocator_alloc( allocator, length + 1);
+		assert( this.heap_items && "DevkitString: could not allocate characters!!!");
+	}
+	memcpy( devkit_string_items( &this), text, length + 1);
+	return this;
 }
 
 
@@ -630,26 +993,448 @@ char* devkit_string_slice( const DevkitString *restrict s, size_t start, size_t
 
 	size_t substr_len = end - start;
 	char *temp = malloc(substr_len + 1);
-	strncpy( temp, s->items + start, substr_len);
+	strncpy( temp, devkit_string_items(s) + start, substr_len);
 	temp[substr_len] = '\0';
 	return temp;
 }
 
 /* Returns DevkitString 's' reversed */
 void devkit_string_reverse( DevkitString *s) {
-	char buffer[s->length];
-	memcpy( buffer, s->items, s->length);
-	for (size_t idx = 0; idx < s->length; idx++) {
-		s->items[idx] = buffer[s->length - idx - 1];
+	char *items = devkit_string_items(s);
+	for (size_t idx = 0; idx < s->length / 2; idx++) {
+		char swap = items[idx];
+		items[idx] = items[s->length - idx - 1];
+		items[s->length - idx - 1] = swap;
 	}
 }
 
 extern void devkit_string_free( DevkitString *s) {
-	if (s->on_heap) free(s);
+	bool isinline = devkit_string_isinline(s);
+	if (s->on_heap) devkit_allocator_free( s->allocator, s, sizeof(*s) + (isinline ? 0 : s->length + 1));
 	else {
-		free(s->items);
+		if (!isinline) devkit_allocator_free( s->allocator, devkit_string_items(s), s->length + 1);
 		s->length = 0;
+		s->inline_items[0] = '\0';
+	}
+}
+
+
+
+DevkitStringBuilder devkit_string_builder( size_t capacity) {
+	return devkit_string_builder_with( nullptr, capacity);
+}
+
+DevkitStringBuilder devkit_string_builder_with( const DevkitAllocator *allocator, size_t capacity) {
+	DevkitStringBuilder builder = {
+		.items = devkit_allocator_alloc( allocator, capacity + 1),
+		.length = 0,
+		.capacity = capacity + 1,
+		.allocator = allocator
+	};
+	assert( builder.items && "DevkitStringBuilder: could not allocate buffer!!!");
+	builder.items[0] = '\0';
+	return builder;
+}
+
+void devkit_string_builder_reserve( DevkitStringBuilder *builder, size_t nchars) {
+	size_t needed = builder->length + nchars + 1;
+	if ( needed <= builder->capacity) return;
+
+	size_t capacity = builder->capacity ? builder->capacity : 16;
+	while ( capacity < needed) capacity *= 2;
+	char *items = devkit_allocator_realloc( builder->allocator, builder->items, builder->capacity, capacity);
+	assert( items && "DevkitStringBuilder: could not grow buffer!!!");
+	builder->items = items;
+	builder->capacity = capacity;
+}
+
+void devkit_string_builder_nappend( DevkitStringBuilder *builder, const char *text, size_t nchars) {
+	devkit_string_builder_reserve( builder, nchars);
+	memcpy( builder->items + builder->length, text, nchars);
+	builder->length += nchars;
+	builder->items[builder->length] = '\0';
+}
+
+void devkit_string_builder_append( DevkitStringBuilder *builder, const char *text) {
+	devkit_string_builder_nappend( builder, text, strlen(text));
+}
+
+void devkit_string_builder_append_char( DevkitStringBuilder *builder, char c) {
+	devkit_string_builder_reserve( builder, 1);
+	builder->items[builder->length++] = c;
+	builder->items[builder->length] = '\0';
+}
+
+void devkit_string_builder_append_string( DevkitStringBuilder *builder, const DevkitString *s) {
+	devkit_string_builder_nappend( builder, devkit_string_items(s), s->length);
+}
+
+void devkit_string_builder_append_int( DevkitStringBuilder *builder, long long value) {
+	devkit_string_builder_reserve( builder, DEVKIT_NUMBER_CHARS);
+	builder->length += devkit_format_int( builder->items + builder->length, value);
+}
+
+void devkit_string_builder_append_double( DevkitStringBuilder *builder, double value) {
+	devkit_string_builder_reserve( builder, DEVKIT_NUMBER_CHARS);
+	builder->length += devkit_format_double( builder->items + builder->length, value);
+}
+
+void devkit_string_builder_appendf( DevkitStringBuilder *builder, const char *format, ...) {
+	va_list args;
+	va_start( args, format);
+	size_t spare = builder->capacity - builder->length;
+	int written = vsnprintf( builder->items + builder->length, spare, format, args);
+	va_end( args);
+	if ( written < 0) return;
+
+	// Not enough room: grow and format again
+	if ( (size_t)written >= spare) {
+		devkit_string_builder_reserve( builder, written);
+		va_start( args, format);
+		vsnprintf( builder->items + builder->length, written + 1, format, args);
+		va_end( args);
+	}
+	builder->length += written;
+}
+
+DevkitString devkit_string_builder_finish( DevkitStringBuilder *builder) {
+	DevkitString s = {
+		.length = builder->length,
+		.allocator = builder->allocator,
+		.on_heap = false
+	};
+	if ( devkit_string_isinline( &s)) {
+		memcpy( s.inline_items, builder->items, builder->length + 1);
+		builder->length = 0;
+		builder->items[0] = '\0';
+		return s;
+	}
+
+	// The string takes the buffer, shrunk to its length (in place for most allocators)
+	s.heap_items = devkit_allocator_realloc( builder->allocator, builder->items, builder->capacity, builder->length + 1);
+	if (!s.heap_items) s.heap_items = builder->items;
+	*builder = (DevkitStringBuilder) { .allocator = builder->allocator };
+	return s;
+}
+
+void devkit_string_builder_clear( DevkitStringBuilder *builder) {
+	builder->length = 0;
+	if ( builder->items) builder->items[0] = '\0';
+}
+
+void devkit_string_builder_free( DevkitStringBuilder *builder) {
+	devkit_allocator_free( builder->allocator, builder->items, builder->capacity);
+	*builder = (DevkitStringBuilder) { .allocator = builder->allocator };
+}
+
+
+/* Search kernels: on 'length' bytes of 'items', they give an index or 'length' if not found.
+ * Each has a scalar, an SSE2 and an AVX2 version, picked once at startup */
+
+size_t _devkit_find_byte_scalar( const char *items, size_t length, char c) {
+	const char *found = memchr( items, c, length);
+	return found ? (size_t)(found - items) : length;
+}
+
+size_t _devkit_count_byte_scalar( const char *items, size_t length, char c) {
+	size_t count = 0;
+	for (size_t idx = 0; idx < length; idx++) count += items[idx] == c;
+	return count;
+}
+
+size_t _devkit_find_bytes_scalar( const char *items, size_t length, const char *needle, size_t nlength) {
+	for (size_t idx = 0; idx + nlength <= length; idx++) {
+		const char *found = memchr( items + idx, needle[0], length - nlength - idx + 1);
+		if (!found) break;
+		idx = found - items;
+		if ( memcmp( found, needle, nlength) == 0) return idx;
+	}
+	return length;
+}
+
+size_t _devkit_mismatch_scalar( const char *a, const char *b, size_t length) {
+	size_t idx = 0;
+	while ( idx < length && a[idx] == b[idx]) idx++;
+	return idx;
+}
+
+#ifdef DEVKIT_STRING_SIMD
+
+__attribute__((target("sse2")))
+size_t _devkit_find_byte_sse2( const char *items, size_t length, char c) {
+	__m128i target = _mm_set1_epi8(c);
+	size_t idx = 0;
+	for (; idx + 16 <= length; idx += 16) {
+		__m128i block = _mm_loadu_si128( (const __m128i*)(items + idx));
+		unsigned mask = _mm_movemask_epi8( _mm_cmpeq_epi8( block, target));
+		if (mask) return idx + __builtin_ctz(mask);
+	}
+	return idx + _devkit_find_byte_scalar( items + idx, length - idx, c);
+}
+
+__attribute__((target("avx2")))
+size_t _devkit_find_byte_avx2( const char *items, size_t length, char c) {
+	__m256i target = _mm256_set1_epi8(c);
+	size_t idx = 0;
+	for (; idx + 32 <= length; idx += 32) {
+		__m256i block = _mm256_loadu_si256( (const __m256i*)(items + idx));
+		unsigned mask = _mm256_movemask_epi8( _mm256_cmpeq_epi8( block, target));
+		if (mask) return idx + __builtin_ctz(mask);
+	}
+	return idx + _devkit_find_byte_sse2( items + idx, length - idx, c);
+}
+
+__attribute__((target("sse2")))
+size_t _devkit_count_byte_sse2( const char *items, size_t length, char c) {
+	__m128i target = _mm_set1_epi8(c);
+	size_t count = 0, idx = 0;
+	for (; idx + 16 <= length; idx += 16) {
+		__m128i block = _mm_loadu_si128( (const __m128i*)(items + idx));
+		count += __builtin_popcount( _mm_movemask_epi8( _mm_cmpeq_epi8( block, target)));
+	}
+	return count + _devkit_count_byte_scalar( items + idx, length - idx, c);
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t _devkit_count_byte_avx2( const char *items, size_t length, char c) {
+	__m256i target = _mm256_set1_epi8(c);
+	size_t count = 0, idx = 0;
+	for (; idx + 32 <= length; idx += 32) {
+		__m256i block = _mm256_loadu_si256( (const __m256i*)(items + idx));
+		count += __builtin_popcount( _mm256_movemask_epi8( _mm256_cmpeq_epi8( block, target)));
+	}
+	return count + _devkit_count_byte_sse2( items + idx, length - idx, c);
+}
+
+/* Substrings are found by comparing the first and last byte of 'needle'
+ * at every position of a block at once, and checking only where both match */
+__attribute__((target("sse2")))
+size_t _devkit_find_bytes_sse2( const char *items, size_t length, const char *needle, size_t nlength) {
+	__m128i first = _mm_set1_epi8( needle[0]), last = _mm_set1_epi8( needle[nlength - 1]);
+	size_t idx = 0;
+	for (; idx + nlength - 1 + 16 <= length; idx += 16) {
+		__m128i block_first = _mm_loadu_si128( (const __m128i*)(items + idx));
+		__m128i block_last = _mm_loadu_si128( (const __m128i*)(items + idx + nlength - 1));
+		unsigned mask = _mm_movemask_epi8( _mm_and_si128(
+					_mm_cmpeq_epi8( first, block_first), _mm_cmpeq_epi8( last, block_last)));
+		for (; mask; mask &= mask - 1) {
+			size_t candidate = idx + __builtin_ctz(mask);
+			if ( memcmp( items + candidate + 1, needle + 1, nlength - 2) == 0) return candidate;
+		}
+	}
+	size_t found = _devkit_find_bytes_scalar( items + idx, length - idx, needle, nlength);
+	return found == length - idx ? length : idx + found;
+}
+
+__attribute__((target("avx2")))
+size_t _devkit_find_bytes_avx2( const char *items, size_t length, const char *needle, size_t nlength) {
+	__m256i first = _mm256_set1_epi8( needle[0]), last = _mm256_set1_epi8( needle[nlength - 1]);
+	size_t idx = 0;
+	for (; idx + nlength - 1 + 32 <= length; idx += 32) {
+		__m256i block_first = _mm256_loadu_si256( (const __m256i*)(items + idx));
+		__m256i block_last = _mm256_loadu_si256( (const __m256i*)(items + idx + nlength - 1));
+		unsigned mask = _mm256_movemask_epi8( _mm256_and_si256(
+					_mm256_cmpeq_epi8( first, block_first), _mm256_cmpeq_epi8( last, block_last)));
+		for (; mask; mask &= mask - 1) {
+			size_t candidate = idx + __builtin_ctz(mask);
+			if ( memcmp( items + candidate + 1, needle + 1, nlength - 2) == 0) return candidate;
+		}
+	}
+	size_t found = _devkit_find_bytes_sse2( items + idx, length - idx, needle, nlength);
+	return found == length - idx ? length : idx + found;
+}
+
+__attribute__((target("sse2")))
+size_t _devkit_mismatch_sse2( const char *a, const char *b, size_t length) {
+	size_t idx = 0;
+	for (; idx + 16 <= length; idx += 16) {
+		__m128i x = _mm_loadu_si128( (const __m128i*)(a + idx)), y = _mm_loadu_si128( (const __m128i*)(b + idx));
+		unsigned mask = _mm_movemask_epi8( _mm_cmpeq_epi8( x, y)) ^ 0xffff;
+		if (mask) return idx + __builtin_ctz(mask);
+	}
+	return idx + _devkit_mismatch_scalar( a + idx, b + idx, length - idx);
+}
+
+__attribute__((target("avx2")))
+size_t _devkit_mismatch_avx2( const char *a, const char *b, size_t length) {
+	size_t idx = 0;
+	for (; idx + 32 <= length; idx += 32) {
+		__m256i x = _mm256_loadu_si256( (const __m256i*)(a + idx)), y = _mm256_loadu_si256( (const __m256i*)(b + idx));
+		unsigned mask = ~(unsigned)_mm256_movemask_epi8( _mm256_cmpeq_epi8( x, y));
+		if (mask) return idx + __builtin_ctz(mask);
+	}
+	return idx + _devkit_mismatch_sse2( a + idx, b + idx, length - idx);
+}
+
+#endif
+
+struct {
+	size_t (*find_byte)( const char *, size_t, char);
+	size_t (*count_byte)( const char *, size_t, char);
+	size_t (*find_bytes)( const char *, size_t, const char *, size_t);
+	size_t (*mismatch)( const char *, const char *, size_t);
+} _DEVKIT_STRING_KERNELS = {
+	_devkit_find_byte_scalar, _devkit_count_byte_scalar, _devkit_find_bytes_scalar, _devkit_mismatch_scalar
+};
+
+/* Picks the kernels for the CPU before 'main' */
+__attribute__((constructor))
+void _devkit_string_dispatch() {
+#ifdef DEVKIT_STRING_SIMD
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports("avx2")) {
+		_DEVKIT_STRING_KERNELS.find_byte = _devkit_find_byte_avx2;
+		_DEVKIT_STRING_KERNELS.count_byte = _devkit_count_byte_avx2;
+		_DEVKIT_STRING_KERNELS.find_bytes = _devkit_find_bytes_avx2;
+		_DEVKIT_STRING_KERNELS.mismatch = _devkit_mismatch_avx2;
+	}
+	else if ( __builtin_cpu_supports("sse2")) {
+		_DEVKIT_STRING_KERNELS.find_byte = _devkit_find_byte_sse2;
+		_DEVKIT_STRING_KERNELS.count_byte = _devkit_count_byte_sse2;
+		_DEVKIT_STRING_KERNELS.find_bytes = _devkit_find_bytes_sse2;
+		_DEVKIT_STRING_KERNELS.mismatch = _devkit_mismatch_sse2;
+	}
+#endif
+}
+
+/* Gives the index of 'needle' in 'items' or 'length', whatever the length of 'needle' */
+size_t _devkit_find( const char *items, size_t length, const char *needle, size_t nlength) {
+	if ( nlength == 0) return 0;
+	if ( nlength > length) return length;
+	if ( nlength == 1) return _DEVKIT_STRING_KERNELS.find_byte( items, length, needle[0]);
+	return _DEVKIT_STRING_KERNELS.find_bytes( items, length, needle, nlength);
+}
+
+size_t devkit_string_find_char( const DevkitString *s, char c, size_t start) {
+	return devkit_string_view_find_char( devkit_string_view(s), c, start);
+}
+
+size_t devkit_string_find( const DevkitString *s, const char *needle, size_t start) {
+	return devkit_string_view_find( devkit_string_view(s), needle, start);
+}
+
+size_t devkit_string_count_char( const DevkitString *s, char c) {
+	return _DEVKIT_STRING_KERNELS.count_byte( devkit_string_items(s), s->length, c);
+}
+
+size_t devkit_string_count( const DevkitString *s, const char *needle) {
+	size_t nlength = strlen(needle);
+	if ( nlength == 1) return devkit_string_count_char( s, needle[0]);
+	if ( nlength == 0) return 0;
+
+	const char *items = devkit_string_items(s);
+	size_t count = 0;
+	for (size_t idx = 0; idx < s->length; idx += nlength, count++) {
+		size_t found = _devkit_find( items + idx, s->length - idx, needle, nlength);
+		if ( found == s->length - idx) break;
+		idx += found;
+	}
+	return count;
+}
+
+bool devkit_string_equals( const DevkitString *a, const DevkitString *b) {
+	return devkit_string_view_equals( devkit_string_view(a), devkit_string_view(b));
+}
+
+int devkit_string_compare( const DevkitString *a, const DevkitString *b) {
+	size_t length = a->length < b->length ? a->length : b->length;
+	const char *x = devkit_string_items(a), *y = devkit_string_items(b);
+	size_t idx = _DEVKIT_STRING_KERNELS.mismatch( x, y, length);
+	if ( idx < length) return (unsigned char)x[idx] < (unsigned char)y[idx] ? -1 : 1;
+	return a->length < b->length ? -1 : a->length > b->length;
+}
+
+DevkitStringSplit devkit_string_split( const DevkitString *s, char delimiter) {
+	return devkit_string_view_split( devkit_string_view(s), delimiter);
+}
+
+DevkitStringSplit devkit_string_view_split( DevkitStringView view, char delimiter) {
+	return (DevkitStringSplit) {
+		.items = view.items,
+		.length = view.length,
+		.position = 0,
+		.delimiter = delimiter
+	};
+}
+
+bool devkit_string_split_next( DevkitStringSplit *split, DevkitStringView *token) {
+	// One past the length once the last token was given
+	if ( split->position > split->length) return false;
+	size_t rest = split->length - split->position;
+	size_t found = _DEVKIT_STRING_KERNELS.find_byte( split->items + split->position, rest, split->delimiter);
+	*token = (DevkitStringView) { .items = split->items + split->position, .length = found };
+	split->position += found + 1;
+	return true;
+}
+
+
+DevkitStringView devkit_string_view( const DevkitString *s) {
+	return (DevkitStringView) { .items = devkit_string_items(s), .length = s->length };
+}
+
+DevkitStringView devkit_string_view_of( const char *text) {
+	return (DevkitStringView) { .items = text, .length = strlen(text) };
+}
+
+DevkitStringView devkit_string_view_slice( DevkitStringView view, size_t start, size_t end) {
+#ifdef DEVKIT_DEBUG
+	assert( start <= end && end <= view.length);
+#endif
+	return (DevkitStringView) { .items = view.items + start, .length = end - start };
+}
+
+DevkitStringView devkit_string_view_trim( DevkitStringView view) {
+	while ( view.length && (view.items[0] == ' ' || (view.items[0] >= '\t' && view.items[0] <= '\r')))
+		view.items++, view.length--;
+	while ( view.length && (view.items[view.length - 1] == ' '
+				|| (view.items[view.length - 1] >= '\t' && view.items[view.length - 1] <= '\r')))
+		view.length--;
+	return view;
+}
+
+DevkitString devkit_string_view_materialize( DevkitStringView view) {
+	return devkit_string_view_materialize_with( nullptr, view);
+}
+
+DevkitString devkit_string_view_materialize_with( const DevkitAllocator *allocator, DevkitStringView view) {
+	DevkitString s = {
+		.length = view.length,
+		.allocator = allocator,
+		.on_heap = false
+	};
+	if ( !devkit_string_isinline( &s)) {
+		s.heap_items = devkit_allocator_alloc( allocator, view.length + 1);
+		assert( s.heap_items && "DevkitString: could not allocate characters!!!");
 	}
+	char *items = devkit_string_items( &s);
+	memcpy( items, view.items, view.length);
+	items[view.length] = '\0';
+	return s;
+}
+
+DevkitIterable devkit_string_view_asiterable( DevkitStringView *view) {
+	return (DevkitIterable) {
+		.typesize = 1,
+		.items = (void*)view->items,
+		.length = view->length,
+		.readonly = true
+	};
+}
+
+size_t devkit_string_view_find_char( DevkitStringView view, char c, size_t start) {
+	if ( start >= view.length) return DEVKIT_STRING_NOT_FOUND;
+	size_t found = _DEVKIT_STRING_KERNELS.find_byte( view.items + start, view.length - start, c);
+	return found == view.length - start ? DEVKIT_STRING_NOT_FOUND : start + found;
+}
+
+size_t devkit_string_view_find( DevkitStringView view, const char *needle, size_t start) {
+	if ( start > view.length) return DEVKIT_STRING_NOT_FOUND;
+	size_t found = _devkit_find( view.items + start, view.length - start, needle, strlen(needle));
+	return found == view.length - start && *needle ? DEVKIT_STRING_NOT_FOUND : start + found;
+}
+
+bool devkit_string_view_equals( DevkitStringView a, DevkitStringView b) {
+	return a.length == b.length && _DEVKIT_STRING_KERNELS.mismatch( a.items, b.items, a.length) == a.length;
 }
 
 #endif
@@ -660,6 +1445,26 @@ extern void devkit_string_free( DevkitString *s) {
 //#define DEVKIT_LIST_IMPLEMENTATION
 #ifdef DEVKIT_LIST_IMPLEMENTATION
 
+#ifdef DEVKIT_LIST_STATS
+// Counters of every list
+struct {
+	atomic_size_t expansions, trims, copied, peak_capacity, wasted;
+} _DEVKIT_LIST_STATS;
+
+void _devkit_list_count_copy( DevkitList *list, size_t bytes) {
+	list->stats.copied += bytes;
+	atomic_fetch_add_explicit( &_DEVKIT_LIST_STATS.copied, bytes, memory_order_relaxed);
+}
+
+void _devkit_list_count_capacity( DevkitList *list) {
+	size_t capacity = list->capacity*list->typesize;
+	if ( capacity > list->stats.peak_capacity) list->stats.peak_capacity = capacity;
+	size_t peak = atomic_load_explicit( &_DEVKIT_LIST_STATS.peak_capacity, memory_order_relaxed);
+	while ( capacity > peak && !atomic_compare_exchange_weak_explicit( &_DEVKIT_LIST_STATS.peak_capacity,
+				&peak, capacity, memory_order_relaxed, memory_order_relaxed));
+}
+#endif
+
 DevkitIterable devkit_list_asiterable( DevkitList *list) {
 #ifdef DEVKIT_DEBUG
 	assert( list != nullptr);
@@ -672,34 +1477,65 @@ DevkitIterable devkit_list_asiterable( DevkitList *list) {
 }
 
 DevkitList* _devkit_list( size_t typesize, size_t capacity) {
-	DevkitList *this = malloc( sizeof(*this) + typesize * capacity);
+	return _devkit_list_with( nullptr, typesize, capacity);
+}
+
+DevkitList* _devkit_list_with( const DevkitAllocator *allocator, size_t typesize, size_t capacity) {
+	DevkitList *this = devkit_allocator_alloc( allocator, sizeof(*this) + typesize * capacity);
 	this->items = this + 1;
 	this->typesize = typesize;
 	this->capacity = capacity;
 	this->length = 0;
+	this->allocator = allocator;
 	this->on_heap = true;
+#ifdef DEVKIT_LIST_STATS
+	this->stats = (DevkitListStats) {0};
+	_devkit_list_count_capacity( this);
+#endif
 	return this;
 }
 
 DevkitList _devkit_list_stack( size_t typesize, size_t capacity) {
+	return _devkit_list_stack_with( nullptr, typesize, capacity);
+}
+
+DevkitList _devkit_list_stack_with( const DevkitAllocator *allocator, size_t typesize, size_t capacity) {
 	return (DevkitList) {
 		.typesize = typesize,
 		.length = 0,
 		.capacity = capacity,
-		.items = calloc(capacity,typesize),
+		.items = devkit_allocator_calloc( allocator, capacity, typesize),
+		.allocator = allocator,
 		.on_heap = false
+#ifdef DEVKIT_LIST_STATS
+		, .stats = { .peak_capacity = capacity*typesize }
+#endif
 	};
 }
 
 
+/* Items of a list allocated on the heap are stored right after the struct,
+ * until the list is expanded */
+#define _devkit_list_inline_items( list) ((list)->on_heap && (list)->items == (void*)((list) + 1))
+
 void devkit_list_free( DevkitList *list) {
 #ifdef DEVKIT_DEBUG
 	assert(list);
 #endif
-	if (list->on_heap) free(list);
+#ifdef DEVKIT_LIST_STATS
+	atomic_fetch_add_explicit( &_DEVKIT_LIST_STATS.wasted,
+			(list->capacity - list->length)*list->typesize, memory_order_relaxed);
+#endif
+	if ( _devkit_list_inline_items( list))
+		devkit_allocator_free( list->allocator, list, sizeof(*list) + list->capacity*list->typesize);
+	else if (list->on_heap) {
+		// The size of the unused inline items is not known anymore
+		devkit_allocator_free( list->allocator, list->items, list->capacity*list->typesize);
+		devkit_allocator_free( list->allocator, list, sizeof(*list));
+	}
 	else {
+		devkit_allocator_free( list->allocator, list->items, list->capacity*list->typesize);
 		list->length = 0, list->capacity = 0, list->typesize = 0;
-		free( list->items);
 	}
 }
 
@@ -745,6 +1581,9 @@ void devkit_list_ninsert( DevkitList *list, size_t index, size_t nitems, void *v
 	// Move following items forward, if there are any
 	if (index < list->length) {
 		memmove( list->items + (index+nitems)*list->typesize, list->items + index*list->typesize, list->typesize*(list->length-nitems - index) );
+#ifdef DEVKIT_LIST_STATS
+		_devkit_list_count_copy( list, list->typesize*(list->length-nitems - index));
+#endif
 	}
 	// Insert values at index
 	memcpy( list->items + (index)*list->typesize, values, nitems*list->typesize);
@@ -763,6 +1602,9 @@ void devkit_list_remove( void *dest, DevkitList *list, size_t index) {
 		void *_dest = list->items + index*list->typesize;
 		void *src = _dest + list->typesize; // list->items + (index+1)*list->typesize
 		memmove( _dest, src, list->typesize * (list->length - 1 - index) );
+#ifdef DEVKIT_LIST_STATS
+		_devkit_list_count_copy( list, list->typesize * (list->length - 1 - index));
+#endif
 	}
 }
 
@@ -789,6 +1631,9 @@ void devkit_list_nremove( void *dest, DevkitList *list, const size_t nitems, con
 			void *_dest = list->items + index*list->typesize, 
 				 *src = list->items + (index+1)*list->typesize;
 			memmove( _dest, src, list->typesize * (list->length - index));
+#ifdef DEVKIT_LIST_STATS
+			_devkit_list_count_copy( list, list->typesize * (list->length - index));
+#endif
 		}
 	}
 }
@@ -852,38 +1697,82 @@ void devkit_list_expand( DevkitList *list, size_t new_capacity) {
 #endif
 
 	size_t prev_size = list->capacity*list->typesize;
-	char buf[ prev_size];
-	memcpy( buf, list->items, prev_size);
-
-	void *new_items = calloc( new_capacity, list->typesize);
+	void *new_items;
+	if ( _devkit_list_inline_items( list)) {
+		// Inline items cannot be resized: move them to their own buffer
+		new_items = devkit_allocator_alloc( list->allocator, new_capacity*list->typesize);
+		if (new_items) memcpy( new_items, list->items, prev_size);
+	}
+	else new_items = devkit_allocator_realloc( list->allocator, list->items, prev_size, new_capacity*list->typesize);
 #ifdef DEVKIT_DEBUG
 	assert(new_items);
 #endif
-	memcpy( new_items, buf, prev_size);
+	memset( (char*)new_items + prev_size, 0, new_capacity*list->typesize - prev_size);
+#ifdef DEVKIT_LIST_STATS
+	++list->stats.expansions;
+	atomic_fetch_add_explicit( &_DEVKIT_LIST_STATS.expansions, 1, memory_order_relaxed);
+	// Items were copied if they moved
+	if ( new_items != list->items) _devkit_list_count_copy( list, prev_size);
+#endif
 	list->items = new_items;
 	list->capacity = new_capacity;
+#ifdef DEVKIT_LIST_STATS
+	_devkit_list_count_capacity( list);
+#endif
 }
 
 void devkit_list_trim( DevkitList *list) {
-#ifndef DEVKIT_DEBUG
+#ifdef DEVKIT_DEBUG
 	assert( list );
 #endif
 
-	if (list->capacity == list->length) return;
-	
-	char buf[list->length];
-	memcpy( buf, list->items, list->length*list->typesize);
-	devkit_list_free( list->items);
+	// Inline items cannot be shrunk
+	if (list->capacity == list->length || _devkit_list_inline_items( list)) return;
 
-	void *trim = malloc( list->length * list->typesize);
+	void *trim = devkit_allocator_realloc( list->allocator, list->items,
+			list->capacity*list->typesize, list->length*list->typesize);
 #ifdef DEVKIT_DEBUG
-	assert(trim);
+	assert(trim || list->length == 0);
 #endif
-	memcpy( trim, buf, list->length*list->typesize);
 
+#ifdef DEVKIT_LIST_STATS
+	++list->stats.trims;
+	atomic_fetch_add_explicit( &_DEVKIT_LIST_STATS.trims, 1, memory_order_relaxed);
+	if ( trim != list->items) _devkit_list_count_copy( list, list->length*list->typesize);
+#endif
 	list->items = trim;
 	list->capacity = list->length;
 }
+
+
+DevkitListStats devkit_list_stats( const DevkitList *list) {
+#ifdef DEVKIT_LIST_STATS
+	DevkitListStats stats = list->stats;
+#else
+	DevkitListStats stats = { .peak_capacity = list->capacity*list->typesize };
+#endif
+	stats.wasted = (list->capacity - list->length)*list->typesize;
+	return stats;
+}
+
+DevkitListStats devkit_list_global_stats() {
+#ifdef DEVKIT_LIST_STATS
+	return (DevkitListStats) {
+		.expansions = atomic_load( &_DEVKIT_LIST_STATS.expansions),
+		.trims = atomic_load( &_DEVKIT_LIST_STATS.trims),
+		.copied = atomic_load( &_DEVKIT_LIST_STATS.copied),
+		.peak_capacity = atomic_load( &_DEVKIT_LIST_STATS.peak_capacity),
+		.wasted = atomic_load( &_DEVKIT_LIST_STATS.wasted)
+	};
+#else
+	return (DevkitListStats) {0};
+#endif
+}
+
+void devkit_list_stats_print( const char *name, const DevkitListStats *stats) {
+	printf("%s: %zu expansions, %zu trims, %zu bytes copied, peak capacity %zu bytes, %zu bytes wasted\n",
+			name, stats->expansions, stats->trims, stats->copied, stats->peak_capacity, stats->wasted);
+}
 #endif
 
 
@@ -902,16 +1791,25 @@ DevkitIterable devkit_array_asiterable( DevkitArray *array) {
 }
 
 DevkitArray* _devkit_array( size_t typesize, size_t length) {
-	DevkitArray *this = malloc( sizeof(*this) + typesize*length);
+	return _devkit_array_with( nullptr, typesize, length);
+}
+
+DevkitArray* _devkit_array_with( const DevkitAllocator *allocator, size_t typesize, size_t length) {
+	DevkitArray *this = devkit_allocator_alloc( allocator, sizeof(*this) + typesize*length);
 	this->typesize = typesize;
 	this->length = length;
 	this->items = this + 1;
+	this->allocator = allocator;
 	this->on_heap = true;
 	return this;
 }
 
 DevkitArray _devkit_array_stack( size_t typesize, size_t length) {
-	void *items = calloc( length, typesize);
+	return _devkit_array_stack_with( nullptr, typesize, length);
+}
+
+DevkitArray _devkit_array_stack_with( const DevkitAllocator *allocator, size_t typesize, size_t length) {
+	void *items = devkit_allocator_calloc( allocator, length, typesize);
 #ifdef DEVKIT_DEBUG
 	assert(items);
 #endif
@@ -919,6 +1817,7 @@ DevkitArray _devkit_array_stack( size_t typesize, size_t length) {
 		.typesize=typesize, 
 		.length=length, 
 		.items=items,
+		.allocator = allocator,
 		.on_heap = false
 	};
 }
@@ -987,10 +1886,11 @@ void devkit_array_concat( void *restrict dest, DevkitArray *array, DevkitArray *
 
 
 void devkit_array_free( DevkitArray *array) {
-	if (array->on_heap) free(array);
+	if (array->on_heap)
+		devkit_allocator_free( array->allocator, array, sizeof(*array) + array->length*array->typesize);
 	else {
+		devkit_allocator_free( array->allocator, array->items, array->length*array->typesize);
 		array->length = 0, array->typesize = 0;
-		free(array->items);
 	}
 }
 
@@ -1090,18 +1990,28 @@ extern DevkitIterable devkit_vector_asiterable( DevkitVector *vec) {
 }
 
 DevkitVector* devkit_vector( size_t length) {
-	DevkitVector *this = malloc( sizeof(*this) + length * sizeof(double));
+	return devkit_vector_with( nullptr, length);
+}
+
+DevkitVector* devkit_vector_with( const DevkitAllocator *allocator, size_t length) {
+	DevkitVector *this = devkit_allocator_alloc( allocator, sizeof(*this) + length * sizeof(double));
 	this->length = length;
 	this->items = (double*)(this + 1);
+	this->allocator = allocator;
 	this->on_heap = true;
 
 	return this;
 }
 
 DevkitVector devkit_vector_stack( size_t length) {
+	return devkit_vector_stack_with( nullptr, length);
+}
+
+DevkitVector devkit_vector_stack_with( const DevkitAllocator *allocator, size_t length) {
 	return (DevkitVector) {
-		.items = calloc( length, sizeof(double)),
+		.items = devkit_allocator_calloc( allocator, length, sizeof(double)),
 		.length = length,
+		.allocator = allocator,
 		.on_heap = false
 	};
 }
@@ -1113,9 +2023,10 @@ extern void devkit_vector_of( DevkitVector *v, double values[]) {
 }
 
 extern void devkit_vector_free( DevkitVector *vec) {
-	if (vec->on_heap) free(vec);
+	if (vec->on_heap)
+		devkit_allocator_free( vec->allocator, vec, sizeof(*vec) + vec->length*sizeof(double));
 	else {
-		free( vec->items);
+		devkit_allocator_free( vec->allocator, vec->items, vec->length*sizeof(double));
 		vec->length = 0;
 	}
 }
@@ -1194,21 +2105,31 @@ extern DevkitIterable devkit_matrix_asiterable( DevkitMatrix *mat) {
 }
 
 DevkitMatrix* devkit_matrix( size_t columns, size_t rows) {
-	DevkitMatrix *this = malloc( sizeof(*this) + columns*rows*sizeof(double));
+	return devkit_matrix_with( nullptr, columns, rows);
+}
+
+DevkitMatrix* devkit_matrix_with( const DevkitAllocator *allocator, size_t columns, size_t rows) {
+	DevkitMatrix *this = devkit_allocator_alloc( allocator, sizeof(*this) + columns*rows*sizeof(double));
 	this->items = (double*)(this + 1);
 	this->columns = columns;
 	this->rows = rows;
 	this->length = columns*rows;
+	this->allocator = allocator;
 	this->on_heap = true;
 	return this;
 }
 
 DevkitMatrix devkit_matrix_stack( size_t columns, size_t rows) {
+	return devkit_matrix_stack_with( nullptr, columns, rows);
+}
+
+DevkitMatrix devkit_matrix_stack_with( const DevkitAllocator *allocator, size_t columns, size_t rows) {
 	return (DevkitMatrix) {
 		.columns = columns,
 		.rows = rows,
 		.length = rows*columns,
-		.items = calloc( rows*columns, sizeof(long)),
+		.items = devkit_allocator_calloc( allocator, rows*columns, sizeof(double)),
+		.allocator = allocator,
 		.on_heap = false
 	};
 }
@@ -1221,9 +2142,10 @@ extern void devkit_matrix_of( DevkitMatrix *mat, double values[]) {
 
 
 extern void devkit_matrix_free( DevkitMatrix *mat) {
-	if (mat->on_heap) free(mat);
+	if (mat->on_heap)
+		devkit_allocator_free( mat->allocator, mat, sizeof(*mat) + mat->length*sizeof(double));
 	else {
-		free(mat->items);
+		devkit_allocator_free( mat->allocator, mat->items, mat->length*sizeof(double));
 		mat->length = 0, mat->columns = 0, mat->rows = 0;
 	}
 }
@@ -1320,6 +2242,554 @@ bool devkit_matrix_iszero( const DevkitMatrix *mat) {
 }
 #endif
 
+/* NUMBERS IMPLEMENTATION */
+
+//#define DEVKIT_NUMBERS_IMPLEMENTATION
+#ifdef DEVKIT_NUMBERS_IMPLEMENTATION
+
+#define _devkit_isdigit( c) ((unsigned char)((c) - '0') < 10)
+
+/* Reads 8 characters as a little endian word */
+uint64_t _devkit_read_eight( const char *chars) {
+	uint64_t word;
+	memcpy( &word, chars, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	word = __builtin_bswap64( word);
+#endif
+	return word;
+}
+
+/* Checks if the 8 characters in 'word' are all digits */
+bool _devkit_is_eight_digits( uint64_t word) {
+	return ((word & 0xF0F0F0F0F0F0F0F0) | (((word + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+		== 0x3333333333333333;
+}
+
+/* Gives the value of the 8 digits in 'word', combining them in pairs, then fours, then eights */
+uint32_t _devkit_eight_digits( uint64_t word) {
+	const uint64_t mask = 0x000000FF000000FF;
+	const uint64_t mul1 = 0x000F424000000064; // 100 + (1000000 << 32)
+	const uint64_t mul2 = 0x0000271000000001; // 1 + (10000 << 32)
+	word -= 0x3030303030303030;
+	word = word*10 + (word >> 8);
+	word = (((word & mask)*mul1) + (((word >> 16) & mask)*mul2)) >> 32;
+	return (uint32_t)word;
+}
+
+
+/* Powers of five from 5^-342 to 5^324, as the 128 most significant bits
+ * (high word first) of their binary expansion. Used by the Eisel-Lemire algorithm
+ * to read doubles and by Schubfach to write them */
+#define _DEVKIT_POW5_MIN (-342)
+#define _DEVKIT_POW5_MAX 324
+uint64_t _DEVKIT_POW5[_DEVKIT_POW5_MAX - _DEVKIT_POW5_MIN + 1][2];
+
+/* The "C" locale, for the few numbers read with 'strtod' */
+locale_t _DEVKIT_C_LOCALE;
+
+/* Big integers to compute the table: enough bits for 2^1792 */
+#define _DEVKIT_BIGINT_LIMBS 29
+
+size_t _devkit_bigint_bits( const uint64_t *x) {
+	for (size_t idx = _DEVKIT_BIGINT_LIMBS; idx-- > 0;) {
+		if ( x[idx]) return idx*64 + 64 - __builtin_clzll( x[idx]);
+	}
+	return 0;
+}
+
+/* Gives the 64 bits of 'x' from bit 'position', that can be negative */
+uint64_t _devkit_bigint_word( const uint64_t *x, long position) {
+	if ( position <= -64) return 0;
+	if ( position < 0) return x[0] << -position;
+	size_t limb = position / 64, shift = position % 64;
+	uint64_t word = limb < _DEVKIT_BIGINT_LIMBS ? x[limb] >> shift : 0;
+	if ( shift && limb + 1 < _DEVKIT_BIGINT_LIMBS) word |= x[limb + 1] << (64 - shift);
+	return word;
+}
+
+/* Stores the 128 most significant bits of 'x' at 'power' in the table */
+void _devkit_pow5_store( int power, const uint64_t *x) {
+	long low = (long)_devkit_bigint_bits(x) - 128;
+	_DEVKIT_POW5[power - _DEVKIT_POW5_MIN][0] = _devkit_bigint_word( x, low + 64);
+	_DEVKIT_POW5[power - _DEVKIT_POW5_MIN][1] = _devkit_bigint_word( x, low);
+}
+
+/* Computes the powers of five before 'main' (a few microseconds): positive powers
+ * multiplying by 5, negative ones dividing 2^1792 by 5 again and again.
+ * Reciprocals are rounded up, so that the products of Eisel-Lemire never exceed the
+ * exact value by more than they can tell */
+__attribute__((constructor))
+void _devkit_numbers_init() {
+	_DEVKIT_C_LOCALE = newlocale( LC_ALL_MASK, "C", (locale_t)0);
+	uint64_t power[_DEVKIT_BIGINT_LIMBS] = {1}, reciprocal[_DEVKIT_BIGINT_LIMBS] = {0};
+	const size_t B = (_DEVKIT_BIGINT_LIMBS - 1)*64;
+	reciprocal[_DEVKIT_BIGINT_LIMBS - 1] = 1; // 2^B
+
+	_devkit_pow5_store( 0, power);
+	for (int q = 1; q <= -_DEVKIT_POW5_MIN; q++) {
+		// power *= 5
+		__uint128_t carry = 0;
+		for (size_t idx = 0; idx < _DEVKIT_BIGINT_LIMBS; idx++) {
+			carry += (__uint128_t)power[idx]*5;
+			power[idx] = (uint64_t)carry;
+			carry >>= 64;
+		}
+		if ( q <= _DEVKIT_POW5_MAX) _devkit_pow5_store( q, power);
+
+		// reciprocal = floor(2^B / 5^q)
+		__uint128_t rest = 0;
+		for (size_t idx = _DEVKIT_BIGINT_LIMBS; idx-- > 0;) {
+			rest = rest << 64 | reciprocal[idx];
+			reciprocal[idx] = (uint64_t)(rest / 5);
+			rest %= 5;
+		}
+
+		// floor(2^b / 5^q) + 1, with 2^b big enough to keep 128 bits of the quotient
+		size_t z = _devkit_bigint_bits( power);
+		size_t b = q <= 27 ? z + 127 : 2*z + 128;
+		uint64_t quotient[_DEVKIT_BIGINT_LIMBS];
+		for (size_t idx = 0; idx < _DEVKIT_BIGINT_LIMBS; idx++)
+			quotient[idx] = _devkit_bigint_word( reciprocal, (long)(B - b + idx*64));
+		for (size_t idx = 0; idx < _DEVKIT_BIGINT_LIMBS && ++quotient[idx] == 0; idx++);
+		_devkit_pow5_store( -q, quotient);
+	}
+}
+
+
+/* Powers of ten that are exact doubles */
+const double _DEVKIT_POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Gives the bits of the double nearest to 'w' * 10^'q' (Eisel-Lemire).
+ * 'w' must not be 0 */
+uint64_t _devkit_eisel_lemire( uint64_t w, int64_t q) {
+	if ( q < _DEVKIT_POW5_MIN) return 0;
+	if ( q > _DEVKIT_POW5_MAX) return 0x7FF0000000000000; // Infinity
+
+	int leading = __builtin_clzll( w);
+	w <<= leading;
+
+	// 'w' times the power of five, with the low bits of the power only if needed
+	const uint64_t *pow5 = _DEVKIT_POW5[q - _DEVKIT_POW5_MIN];
+	__uint128_t product = (__uint128_t)w * pow5[0];
+	uint64_t high = product >> 64, low = (uint64_t)product;
+	const uint64_t precision = UINT64_MAX >> 55;
+	if ( (high & precision) == precision) {
+		uint64_t extra = ((__uint128_t)w * pow5[1]) >> 64;
+		low += extra;
+		if ( extra > low) ++high;
+	}
+
+	int upperbit = high >> 63;
+	int shift = upperbit + 64 - 52 - 3;
+	uint64_t mantissa = high >> shift;
+	// Binary exponent of 10^q is about q*log2(10)
+	int64_t power2 = (((152170 + 65536)*q) >> 16) + 63 + upperbit - leading + 1023;
+
+	if ( power2 <= 0) {
+		// Subnormal, or zero
+		if ( -power2 + 1 >= 64) return 0;
+		mantissa >>= -power2 + 1;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+		// Rounding up can make it normal again
+		power2 = mantissa < (1ull << 52) ? 0 : 1;
+		return (uint64_t)power2 << 52 | (mantissa & ((1ull << 52) - 1));
+	}
+
+	// Exactly halfway between two doubles: round to even.
+	// Only possible when 5^q fits in 64 bits
+	if ( low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high)
+		mantissa &= ~1ull;
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if ( mantissa >= (2ull << 52)) {
+		mantissa = 1ull << 52;
+		++power2;
+	}
+	if ( power2 >= 0x7FF) return 0x7FF0000000000000;
+	return (uint64_t)power2 << 52 | (mantissa & ((1ull << 52) - 1));
+}
+
+/* Reads the 'length' characters of 'text' with 'strtod', for the rare numbers
+ * Eisel-Lemire cannot decide. The thread switches to the "C" locale meanwhile,
+ * so that '.' is the decimal point whatever the program set */
+double _devkit_parse_double_slow( const char *text, size_t length) {
+	char small[128];
+	char *copy = length + 1 <= sizeof(small) ? small : malloc( length + 1);
+	assert( copy && "devkit_parse_double: could not allocate copy!!!");
+	memcpy( copy, text, length);
+	copy[length] = '\0';
+
+	locale_t previous = uselocale( _DEVKIT_C_LOCALE);
+	double value = strtod( copy, nullptr);
+	uselocale( previous);
+	if ( copy != small) free( copy);
+	return value;
+}
+
+/* Reads "inf", "infinity" or "nan" (any case) at the start of 'text' */
+size_t _devkit_parse_special( const char *text, size_t length, double *dest) {
+	const char *words[] = { "infinity", "inf", "nan" };
+	const size_t lengths[] = { 8, 3, 3 };
+	for (size_t word = 0; word < 3; word++) {
+		if ( length < lengths[word]) continue;
+		size_t idx = 0;
+		while ( idx < lengths[word] && (text[idx] | 0x20) == words[word][idx]) idx++;
+		if ( idx < lengths[word]) continue;
+		*dest = word < 2 ? INFINITY : NAN;
+		return lengths[word];
+	}
+	return 0;
+}
+
+
+size_t devkit_parse_uint( DevkitStringView view, unsigned long long *dest) {
+	const char *p = view.items, *end = view.items + view.length;
+	while ( p < end && *p == '0') p++;
+
+	// Up to 19 digits cannot overflow
+	uint64_t value = 0;
+	const char *fast_end = end - p > 19 ? p + 19 : end;
+	if ( fast_end - p >= 8) {
+		uint64_t word = _devkit_read_eight(p);
+		if ( _devkit_is_eight_digits( word)) {
+			value = _devkit_eight_digits( word);
+			p += 8;
+		}
+	}
+	while ( p < fast_end && _devkit_isdigit(*p)) value = value*10 + (*p++ - '0');
+	for (; p < end && _devkit_isdigit(*p); p++) {
+		if ( __builtin_mul_overflow( value, 10, &value)
+				|| __builtin_add_overflow( value, (uint64_t)(*p - '0'), &value))
+			return 0;
+	}
+	if ( p == view.items) return 0;
+	*dest = value;
+	return p - view.items;
+}
+
+size_t devkit_parse_int( DevkitStringView view, long long *dest) {
+	bool negative = false;
+	size_t sign = 0;
+	if ( view.length && (view.items[0] == '-' || view.items[0] == '+')) {
+		negative = view.items[0] == '-';
+		sign = 1;
+	}
+	unsigned long long magnitude;
+	size_t ndigits = devkit_parse_uint( devkit_string_view_slice( view, sign, view.length), &magnitude);
+	if ( !ndigits) return 0;
+	if ( magnitude > (unsigned long long)LLONG_MAX + negative) return 0;
+	*dest = negative ? (long long)(0 - magnitude) : (long long)magnitude;
+	return sign + ndigits;
+}
+
+size_t devkit_parse_double( DevkitStringView view, double *dest) {
+	const char *p = view.items, *end = view.items + view.length;
+	bool negative = false;
+	if ( p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+	// Digits are gathered in 'w', that may overflow if there are more than 19
+	uint64_t w = 0;
+	const char *integer = p;
+	while ( end - p >= 8 && _devkit_is_eight_digits( _devkit_read_eight(p))) {
+		w = w*100000000 + _devkit_eight_digits( _devkit_read_eight(p));
+		p += 8;
+	}
+	while ( p < end && _devkit_isdigit(*p)) w = w*10 + (*p++ - '0');
+	const char *integer_end = p, *fraction = p, *fraction_end = p;
+	int64_t exponent = 0;
+
+	if ( p < end && *p == '.') {
+		fraction = ++p;
+		while ( end - p >= 8 && _devkit_is_eight_digits( _devkit_read_eight(p))) {
+			w = w*100000000 + _devkit_eight_digits( _devkit_read_eight(p));
+			p += 8;
+		}
+		while ( p < end && _devkit_isdigit(*p)) w = w*10 + (*p++ - '0');
+		fraction_end = p;
+		exponent = fraction - p;
+	}
+	int64_t ndigits = (integer_end - integer) + (fraction_end - fraction);
+	if ( ndigits == 0) {
+		size_t nspecial = _devkit_parse_special( integer, end - integer, dest);
+		if ( !nspecial) return 0;
+		if ( negative) *dest = -*dest;
+		return integer - view.items + nspecial;
+	}
+
+	// The exponent is read only if it has digits
+	int64_t explicit_exponent = 0;
+	if ( p < end && (*p | 0x20) == 'e') {
+		const char *e = p + 1;
+		bool eneg = false;
+		if ( e < end && (*e == '-' || *e == '+')) eneg = *e++ == '-';
+		if ( e < end && _devkit_isdigit(*e)) {
+			for (; e < end && _devkit_isdigit(*e); e++) {
+				if ( explicit_exponent < 0x10000000) explicit_exponent = explicit_exponent*10 + (*e - '0');
+			}
+			if ( eneg) explicit_exponent = -explicit_exponent;
+			p = e;
+		}
+	}
+	exponent += explicit_exponent;
+	size_t consumed = p - view.items;
+
+	// Too many digits: keep the first 19 significant ones
+	bool truncated = false;
+	if ( ndigits > 19) {
+		for (const char *s = integer; s < end && (*s == '0' || *s == '.'); s++) {
+			if ( *s == '0') --ndigits;
+		}
+		if ( ndigits > 19) {
+			truncated = true;
+			const uint64_t nineteen_digits = 1000000000000000000;
+			w = 0;
+			const char *s = integer;
+			while ( w < nineteen_digits && s < integer_end) w = w*10 + (*s++ - '0');
+			if ( w >= nineteen_digits) exponent = (integer_end - s) + explicit_exponent;
+			else {
+				s = fraction;
+				while ( w < nineteen_digits && s < fraction_end) w = w*10 + (*s++ - '0');
+				exponent = (fraction - s) + explicit_exponent;
+			}
+		}
+	}
+
+	double value;
+	if ( w == 0) value = 0;
+	else if ( !truncated && w <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+		// Both 'w' and the power of ten are exact, so one operation rounds correctly
+		value = (double)w;
+		value = exponent < 0 ? value / _DEVKIT_POW10[-exponent] : value * _DEVKIT_POW10[exponent];
+	}
+	else {
+		uint64_t bits = _devkit_eisel_lemire( w, exponent);
+		// The digits after the first 19 are between 'w' and 'w'+1: if both give the
+		// same double, so do they
+		if ( truncated && bits != _devkit_eisel_lemire( w + 1, exponent))
+			value = _devkit_parse_double_slow( integer, consumed - (integer - view.items));
+		else memcpy( &value, &bits, sizeof(value));
+	}
+	*dest = negative ? -value : value;
+	return consumed;
+}
+
+
+bool devkit_string_to_int( const DevkitString *s, long long *dest) {
+	long long value;
+	if ( !s->length || devkit_parse_int( devkit_string_view(s), &value) != s->length) return false;
+	*dest = value;
+	return true;
+}
+
+bool devkit_string_to_double( const DevkitString *s, double *dest) {
+	double value;
+	if ( !s->length || devkit_parse_double( devkit_string_view(s), &value) != s->length) return false;
+	*dest = value;
+	return true;
+}
+
+
+/* Gives the position of the first character of 'text' from 'position' that is not a separator */
+size_t _devkit_skip_separators( DevkitStringView text, size_t position) {
+	while ( position < text.length) {
+		char c = text.items[position];
+		if ( c != ' ' && c != ',' && c != ';' && (c < '\t' || c > '\r')) break;
+		++position;
+	}
+	return position;
+}
+
+size_t devkit_parse_doubles( DevkitVector *dest, DevkitStringView text) {
+	size_t count = 0, position = _devkit_skip_separators( text, 0);
+	while ( count < dest->length && position < text.length) {
+		size_t nchars = devkit_parse_double( devkit_string_view_slice( text, position, text.length),
+				&dest->items[count]);
+		if ( !nchars) break;
+		++count;
+		position = _devkit_skip_separators( text, position + nchars);
+	}
+	return count;
+}
+
+size_t devkit_parse_doubles_list( DevkitList *dest, DevkitStringView text) {
+	assert( dest->typesize == sizeof(double) && "devkit_parse_doubles_list: not a list of double!!!");
+	size_t count = 0, position = _devkit_skip_separators( text, 0);
+	while ( position < text.length) {
+		if ( dest->length == dest->capacity) devkit_list_expand( dest, dest->capacity ? dest->capacity*2 : 16);
+		size_t nchars = devkit_parse_double( devkit_string_view_slice( text, position, text.length),
+				(double*)dest->items + dest->length);
+		if ( !nchars) break;
+		++dest->length, ++count;
+		position = _devkit_skip_separators( text, position + nchars);
+	}
+	return count;
+}
+
+size_t devkit_parse_ints_list( DevkitList *dest, DevkitStringView text) {
+	assert( dest->typesize == sizeof(long long) && "devkit_parse_ints_list: not a list of long long!!!");
+	size_t count = 0, position = _devkit_skip_separators( text, 0);
+	while ( position < text.length) {
+		if ( dest->length == dest->capacity) devkit_list_expand( dest, dest->capacity ? dest->capacity*2 : 16);
+		size_t nchars = devkit_parse_int( devkit_string_view_slice( text, position, text.length),
+				(long long*)dest->items + dest->length);
+		if ( !nchars) break;
+		++dest->length, ++count;
+		position = _devkit_skip_separators( text, position + nchars);
+	}
+	return count;
+}
+
+
+size_t devkit_format_int( char *dest, long long value) {
+	// Digits are written backwards, then moved in place
+	char digits[24];
+	size_t ndigits = 0;
+	unsigned long long magnitude = value < 0 ? -(unsigned long long)value : (unsigned long long)value;
+	do {
+		digits[sizeof(digits) - ++ndigits] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude);
+	if ( value < 0) digits[sizeof(digits) - ++ndigits] = '-';
+	memcpy( dest, digits + sizeof(digits) - ndigits, ndigits);
+	dest[ndigits] = '\0';
+	return ndigits;
+}
+
+/* Shortest decimal of a double: 'digits' * 10^'exponent' */
+typedef struct {
+	uint64_t digits;
+	int exponent;
+} _DevkitDecimal;
+
+/* Gives 'g' * 'c' / 2^128, with its lowest bit set if it is not exact */
+uint64_t _devkit_round_to_odd( const uint64_t g[2], uint64_t c) {
+	__uint128_t low = (__uint128_t)g[1] * c;
+	__uint128_t high = (__uint128_t)g[0] * c + (uint64_t)(low >> 64);
+	return (uint64_t)(high >> 64) | ((uint64_t)high > 1);
+}
+
+/* Finds the shortest decimal that reads back as the positive finite double of
+ * 'bits', the nearest one if there are several (Schubfach, by Raffaello Giulietti) */
+_DevkitDecimal _devkit_shortest( uint64_t bits) {
+	uint64_t fraction = bits & ((1ull << 52) - 1);
+	int biased = bits >> 52;
+	uint64_t c;
+	int q;
+	if ( biased) {
+		c = fraction | 1ull << 52;
+		q = biased - 1075;
+		// Integers below 2^53 are their own digits
+		if ( q <= 0 && q > -53 && !(c & ((1ull << -q) - 1)))
+			return (_DevkitDecimal) { .digits = c >> -q, .exponent = 0 };
+	}
+	else {
+		c = fraction;
+		q = -1074;
+	}
+
+	// The doubles that round to this one are between 'cbl' and 'cbr' (in quarters of 2^q).
+	// Below powers of two the gap to the previous double is half as wide
+	bool even = !(c & 1), closer = !fraction && biased > 1;
+	uint64_t cbl = 4*c - 2 + closer, cb = 4*c, cbr = 4*c + 2;
+	// k = floor(log10(2^q)), or of 3/4 * 2^q when the lower gap is half as wide
+	int k = closer ? (q*1262611 - 524031) >> 22 : (q*1262611) >> 22;
+	// h = q + floor(log2(10^-k)) + 1, from 1 to 4
+	int h = q + ((-k*1741647) >> 19) + 1;
+
+	// 10^-k, rounded up to 128 bits
+	const uint64_t *pow5 = _DEVKIT_POW5[-k - _DEVKIT_POW5_MIN];
+	uint64_t g[2] = { pow5[0], pow5[1] };
+	if ( -k >= 0 && ++g[1] == 0) ++g[0];
+
+	uint64_t vbl = _devkit_round_to_odd( g, cbl << h);
+	uint64_t vb = _devkit_round_to_odd( g, cb << h);
+	uint64_t vbr = _devkit_round_to_odd( g, cbr << h);
+	uint64_t lower = vbl + !even, upper = vbr - !even;
+
+	// One digit less, if only one of the two candidates is inside
+	uint64_t s = vb / 4;
+	if ( s >= 10) {
+		uint64_t sp = s / 10;
+		bool up_inside = lower <= 40*sp, wp_inside = 40*sp + 40 <= upper;
+		if ( up_inside != wp_inside)
+			return (_DevkitDecimal) { .digits = sp + wp_inside, .exponent = k + 1 };
+	}
+	bool u_inside = lower <= 4*s, w_inside = 4*s + 4 <= upper;
+	if ( u_inside != w_inside)
+		return (_DevkitDecimal) { .digits = s + w_inside, .exponent = k };
+	// Both are inside: the nearest, or the even one on a tie
+	uint64_t middle = 4*s + 2;
+	bool up = vb > middle || (vb == middle && (s & 1));
+	return (_DevkitDecimal) { .digits = s + up, .exponent = k };
+}
+
+size_t devkit_format_double( char *dest, double value) {
+	if ( isnan(value)) return strcpy( dest, "nan"), 3;
+	if ( isinf(value)) return value < 0 ? (strcpy( dest, "-inf"), 4) : (strcpy( dest, "inf"), 3);
+
+	uint64_t bits;
+	memcpy( &bits, &value, sizeof(bits));
+	size_t length = 0;
+	if ( bits >> 63) dest[length++] = '-';
+	bits &= ~(1ull << 63);
+	if ( !bits) {
+		dest[length++] = '0';
+		dest[length] = '\0';
+		return length;
+	}
+
+	_DevkitDecimal decimal = _devkit_shortest( bits);
+	while ( decimal.digits % 10 == 0) decimal.digits /= 10, decimal.exponent++;
+	char digits[20];
+	int ndigits = 0;
+	for (uint64_t rest = decimal.digits; rest; rest /= 10) digits[sizeof(digits) - ++ndigits] = '0' + rest % 10;
+	const char *first = digits + sizeof(digits) - ndigits;
+
+	// Laid out like '%g' with 15 digits of precision, or more if they are needed
+	int point = decimal.exponent + ndigits; // Digits before the decimal point
+	if ( point - 1 < -4 || point - 1 >= (ndigits > 15 ? ndigits : 15)) {
+		dest[length++] = first[0];
+		if ( ndigits > 1) {
+			dest[length++] = '.';
+			memcpy( dest + length, first + 1, ndigits - 1);
+			length += ndigits - 1;
+		}
+		int exponent = point - 1;
+		dest[length++] = 'e';
+		dest[length++] = exponent < 0 ? '-' : '+';
+		if ( exponent < 0) exponent = -exponent;
+		if ( exponent >= 100) dest[length++] = '0' + exponent / 100;
+		dest[length++] = '0' + exponent / 10 % 10;
+		dest[length++] = '0' + exponent % 10;
+	}
+	else if ( point <= 0) {
+		memcpy( dest + length, "0.", 2);
+		memset( dest + length + 2, '0', -point);
+		length += 2 - point;
+		memcpy( dest + length, first, ndigits);
+		length += ndigits;
+	}
+	else if ( point >= ndigits) {
+		memcpy( dest + length, first, ndigits);
+		memset( dest + length + ndigits, '0', point - ndigits);
+		length += point;
+	}
+	else {
+		memcpy( dest + length, first, point);
+		dest[length + point] = '.';
+		memcpy( dest + length + point + 1, first + point, ndigits - point);
+		length += ndigits + 1;
+	}
+	dest[length] = '\0';
+	return length;
+}
+
+#endif
+
 
 
 #endif